@@ -0,0 +1,299 @@
+/* R bindings for BMRestore, LogPost and RegenDist
+ *
+ * Compile from R with
+ *   Rcpp::sourceCpp("bindings/R/bmrstr_r.cpp")
+ * Requires Rcpp, RcppArmadillo and R >= 3.5.
+ *
+ * LogPost and RegenDist objects are constructed by name, as in Python, and
+ * may be shared by several samplers.
+ *
+ * Output states, times and tour numbers are returned as ALTREP vectors
+ * viewing the sampler's own buffers. Each vector holds a reference to the
+ * sampler and looks its buffer up on every access, so it stays valid if
+ * the sampler simulates further tours. Element access, subsetting,
+ * printing, and code reading by region (e.g. sum, range) or through
+ * REAL_RO/INTEGER_RO read the buffer without copying. Anything asking for
+ * a writeable pointer through REAL()/INTEGER(), which includes most
+ * compiled code such as %*% and colMeans, and any modification, first
+ * copies the vector into a private buffer, once.
+ * R has no single precision type, so states stored as floats are copied
+ * into an ordinary numeric matrix.
+ */
+// [[Rcpp::depends(RcppArmadillo)]]
+// [[Rcpp::plugins(cpp17)]]
+#include <RcppArmadillo.h>
+#include <R_ext/Altrep.h>
+#include <algorithm>
+#include <cstring>
+#include "../../include/bmrstr.h"
+#include "../targets.h"
+
+// sourceCpp compiles a single translation unit
+#include "../../src/bmrstr.cpp"
+#include "../../src/diffusion.cpp"
+#include "../../src/log_post.cpp"
+#include "../../src/logistic.cpp"
+#include "../../src/mvg.cpp"
+#include "../../src/regen_dist.cpp"
+#include "../../src/sobol.cpp"
+#include "../../src/variate_stream.cpp"
+
+// Which output buffer an ALTREP vector views
+#define OUTPUT_STATES 0
+#define OUTPUT_TIMES 1
+#define OUTPUT_TOURS 2
+
+static R_altrep_class_t output_real_class;
+static R_altrep_class_t output_int_class;
+
+static BMRestore* altrep_sampler(SEXP x)
+{
+    return (BMRestore*) R_ExternalPtrAddr(R_altrep_data1(x));
+}
+
+// data2 holds the length and which buffer is viewed
+static R_xlen_t output_length(SEXP x)
+{
+    return (R_xlen_t) REAL(R_altrep_data2(x))[0];
+}
+
+// Buffer of the sampler viewed by x
+static void* output_buffer(SEXP x)
+{
+    BMRestore* X = altrep_sampler(x);
+    switch ((int) REAL(R_altrep_data2(x))[1]){
+    case OUTPUT_STATES:
+        return (void*) X->get_output_states_data();
+    case OUTPUT_TIMES:
+        return (void*) X->get_output_times_data();
+    default:
+        return (void*) X->get_output_tour_number_data();
+    }
+}
+
+// Writing to a vector in place would change the sampler's buffer and every
+// other view of it, so the first writeable access copies the buffer into
+// an ordinary vector, which then replaces the sampler in data1
+static void* output_dataptr(SEXP x, Rboolean writeable)
+{
+    SEXP data1 = R_altrep_data1(x);
+    int tours = (int) REAL(R_altrep_data2(x))[1] == OUTPUT_TOURS;
+    if (TYPEOF(data1) != EXTPTRSXP){
+        return tours ? (void*) INTEGER(data1) : (void*) REAL(data1);
+    }
+    if (!writeable){
+        return output_buffer(x);
+    }
+    
+    R_xlen_t n = output_length(x);
+    SEXP copy = PROTECT(Rf_allocVector(tours ? INTSXP : REALSXP, n));
+    void* p = tours ? (void*) INTEGER(copy) : (void*) REAL(copy);
+    size_t size = tours ? sizeof(int) : sizeof(double);
+    if (n > 0){
+        std::memcpy(p, output_buffer(x), n * size);
+    }
+    R_set_altrep_data1(x, copy);
+    UNPROTECT(1);
+    return p;
+}
+
+static const void* output_dataptr_or_null(SEXP x)
+{
+    return output_dataptr(x, FALSE);
+}
+
+static double output_real_elt(SEXP x, R_xlen_t i)
+{
+    return ((const double*) output_dataptr(x, FALSE))[i];
+}
+
+static int output_int_elt(SEXP x, R_xlen_t i)
+{
+    return ((const int*) output_dataptr(x, FALSE))[i];
+}
+
+// Copy elements i, ..., i+n-1, or up to the end, into buf
+static R_xlen_t output_real_get_region(SEXP x, R_xlen_t i, R_xlen_t n,
+                                       double* buf)
+{
+    R_xlen_t m = std::min(n, output_length(x) - i);
+    const double* p = (const double*) output_dataptr(x, FALSE);
+    std::copy(p + i, p + i + m, buf);
+    return m;
+}
+
+static R_xlen_t output_int_get_region(SEXP x, R_xlen_t i, R_xlen_t n,
+                                      int* buf)
+{
+    R_xlen_t m = std::min(n, output_length(x) - i);
+    const int* p = (const int*) output_dataptr(x, FALSE);
+    std::copy(p + i, p + i + m, buf);
+    return m;
+}
+
+static Rboolean output_inspect(SEXP x, int pre, int deep, int pvec,
+                               void (*inspect_subtree)(SEXP, int, int, int))
+{
+    Rprintf("bmrstr output view (length %lld)\n",
+            (long long) output_length(x));
+    return TRUE;
+}
+
+// [[Rcpp::init]]
+void bmrstr_init(DllInfo* dll)
+{
+    output_real_class = R_make_altreal_class("bmrstr_real", "bmrstr", dll);
+    R_set_altrep_Length_method(output_real_class, output_length);
+    R_set_altrep_Inspect_method(output_real_class, output_inspect);
+    R_set_altvec_Dataptr_method(output_real_class, output_dataptr);
+    R_set_altvec_Dataptr_or_null_method(output_real_class,
+                                        output_dataptr_or_null);
+    R_set_altreal_Elt_method(output_real_class, output_real_elt);
+    R_set_altreal_Get_region_method(output_real_class,
+                                    output_real_get_region);
+    
+    output_int_class = R_make_altinteger_class("bmrstr_int", "bmrstr", dll);
+    R_set_altrep_Length_method(output_int_class, output_length);
+    R_set_altrep_Inspect_method(output_int_class, output_inspect);
+    R_set_altvec_Dataptr_method(output_int_class, output_dataptr);
+    R_set_altvec_Dataptr_or_null_method(output_int_class,
+                                        output_dataptr_or_null);
+    R_set_altinteger_Elt_method(output_int_class, output_int_elt);
+    R_set_altinteger_Get_region_method(output_int_class,
+                                       output_int_get_region);
+}
+
+// Construct an ALTREP vector of length n viewing the given buffer
+static SEXP output_view(Rcpp::XPtr<BMRestore> X, R_xlen_t n, int which)
+{
+    Rcpp::NumericVector info = Rcpp::NumericVector::create(n, which);
+    if (which == OUTPUT_TOURS){
+        return R_new_altrep(output_int_class, X, info);
+    }
+    return R_new_altrep(output_real_class, X, info);
+}
+
+/* Construct a target by name, see bindings/targets.h
+ */
+// [[Rcpp::export]]
+SEXP bmrstr_log_post(int dimension, const arma::mat &data, std::string target)
+{
+    LogPost* posterior = new LogPost(make_log_post(dimension, data, target));
+    return Rcpp::XPtr<LogPost>(posterior, true);
+}
+
+// [[Rcpp::export]]
+int bmrstr_log_post_dimension(SEXP ptr)
+{
+    return Rcpp::XPtr<LogPost>(ptr)->get_dimension();
+}
+
+// [[Rcpp::export]]
+double bmrstr_log_dens(SEXP ptr, const arma::vec &state)
+{
+    return Rcpp::XPtr<LogPost>(ptr)->log_dens(state);
+}
+
+/* Construct a regeneration distribution by name, see bindings/targets.h
+ */
+// [[Rcpp::export]]
+SEXP bmrstr_regen_dist(int dimension, const arma::mat &data, std::string dist)
+{
+    RegenDist* regen_dist = new RegenDist(make_regen_dist(dimension, data,
+                                                          dist));
+    return Rcpp::XPtr<RegenDist>(regen_dist, true);
+}
+
+// [[Rcpp::export]]
+int bmrstr_regen_dist_dimension(SEXP ptr)
+{
+    return Rcpp::XPtr<RegenDist>(ptr)->get_dimension();
+}
+
+/* Construct a sampler
+ *
+ * posterior, regen_dist : from bmrstr_log_post and bmrstr_regen_dist.
+ *                         Samplers copy them, sharing the target's data.
+ */
+// [[Rcpp::export]]
+SEXP bmrstr_new(SEXP posterior,
+                SEXP regen_dist,
+                double logC,
+                double kappa_bar,
+                int ntours = 10000,
+                double output_rate = 1.0,
+                int seed = 0)
+{
+    BMRestore* X = new BMRestore(*Rcpp::XPtr<LogPost>(posterior),
+                                 *Rcpp::XPtr<RegenDist>(regen_dist),
+                                 logC, kappa_bar, ntours, output_rate);
+    X->set_seed(seed);
+    return Rcpp::XPtr<BMRestore>(X, true);
+}
+
+// [[Rcpp::export]]
+void bmrstr_set_covariance(SEXP ptr, const arma::mat &cov)
+{
+    Rcpp::XPtr<BMRestore>(ptr)->set_covariance(cov);
+}
+
+// [[Rcpp::export]]
+void bmrstr_set_output_precision(SEXP ptr, int single)
+{
+    Rcpp::XPtr<BMRestore>(ptr)->set_output_precision(single);
+}
+
+// [[Rcpp::export]]
+void bmrstr_gen_fixed_ntours(SEXP ptr, int ntours)
+{
+    Rcpp::XPtr<BMRestore> X(ptr);
+    X->set_ntours(ntours);
+    X->gen_fixed_ntours();
+}
+
+// [[Rcpp::export]]
+int bmrstr_nevals(SEXP ptr)
+{
+    return Rcpp::XPtr<BMRestore>(ptr)->get_nevals();
+}
+
+// dimension x noutputs matrix of output states, one column per output
+// [[Rcpp::export]]
+SEXP bmrstr_output_states(SEXP ptr)
+{
+    Rcpp::XPtr<BMRestore> X(ptr);
+    R_xlen_t n = X->get_noutputs();
+    int d = X->get_dimension();
+    SEXP x;
+    if (X->is_output_single()){
+        x = PROTECT(Rf_allocVector(REALSXP, n * d));
+        const float* xs = X->get_output_states_data_single();
+        for (R_xlen_t i = 0; i < n * d; i++){
+            REAL(x)[i] = xs[i];
+        }
+    } else {
+        x = PROTECT(output_view(X, n * d, OUTPUT_STATES));
+    }
+    
+    // States are stored column-major as dimension x noutputs
+    SEXP dim = PROTECT(Rf_allocVector(INTSXP, 2));
+    INTEGER(dim)[0] = d;
+    INTEGER(dim)[1] = n;
+    Rf_setAttrib(x, R_DimSymbol, dim);
+    UNPROTECT(2);
+    return x;
+}
+
+// [[Rcpp::export]]
+SEXP bmrstr_output_times(SEXP ptr)
+{
+    Rcpp::XPtr<BMRestore> X(ptr);
+    return output_view(X, X->get_noutputs(), OUTPUT_TIMES);
+}
+
+// [[Rcpp::export]]
+SEXP bmrstr_output_tour_number(SEXP ptr)
+{
+    Rcpp::XPtr<BMRestore> X(ptr);
+    return output_view(X, X->get_noutputs(), OUTPUT_TOURS);
+}
@@ -0,0 +1,240 @@
+/* Python bindings for BMRestore, LogPost and RegenDist
+ *
+ * Output states, times and tour numbers are returned as read-only NumPy
+ * arrays that view the sampler's buffers directly. The arrays keep the
+ * sampler alive, and further simulation, which may reallocate the buffers,
+ * raises an error while any of them (or arrays derived from them) exist.
+ * Copy the arrays to keep outputs across simulations. While a sampler
+ * simulates with the GIL released, every other call on it from another
+ * thread raises an error.
+ * gen_fixed_ntours releases the GIL, so samplers may run concurrently in
+ * separate Python threads.
+ */
+#include "bmrstr.h"
+#include "diffusion.h"
+#include "log_post.h"
+#include "regen_dist.h"
+#include "../targets.h"
+#include <armadillo>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace py = pybind11;
+
+typedef py::array_t<double, py::array::f_style | py::array::forcecast>
+    farray;
+
+// Copy a two-dimensional NumPy array into an Armadillo matrix
+static arma::mat to_mat(farray a)
+{
+    if (a.ndim() != 2){
+        throw std::invalid_argument("Expected a two-dimensional array");
+    }
+    return arma::mat(a.data(), a.shape(0), a.shape(1));
+}
+
+// Sampler counting the live views of its output buffers, and flagged busy
+// while it simulates with the GIL released
+class PyBMRestore : public BMRestore
+{
+public:
+    using BMRestore::BMRestore;
+    int m_nviews = 0;
+    bool m_busy = false;
+};
+
+// Throw if another thread is simulating with the sampler
+static void check_idle(PyBMRestore &X)
+{
+    if (X.m_busy){
+        throw std::runtime_error("Sampler is simulating in another thread");
+    }
+}
+
+// Marks a sampler busy for the guard's lifetime. Construct it, and so
+// destroy it, with the GIL held.
+class BusyGuard
+{
+public:
+    BusyGuard(PyBMRestore &X) : m_X(X)
+    {
+        check_idle(X);
+        m_X.m_busy = true;
+    }
+    ~BusyGuard()
+    {
+        m_X.m_busy = false;
+    }
+    
+private:
+    PyBMRestore &m_X;
+};
+
+// Bind a member function of BMRestore, raising if the sampler is busy
+template<typename R, typename... Args>
+static auto idle(R (BMRestore::*f)(Args...))
+{
+    return [f](PyBMRestore &X, Args... args){
+        check_idle(X);
+        return (X.*f)(args...);
+    };
+}
+
+// Base of an output view, keeping the sampler alive and counted as viewed
+// until the view is destroyed
+static py::capsule view_base(py::object self)
+{
+    self.cast<PyBMRestore&>().m_nviews++;
+    return py::capsule(new py::object(self), [](void *p){
+        py::object *owner = (py::object*) p;
+        owner->cast<PyBMRestore&>().m_nviews--;
+        delete owner;
+    });
+}
+
+// Mark a view read-only, since it points into the sampler's buffers
+static py::array read_only(py::array a)
+{
+    a.attr("setflags")(py::arg("write") = false);
+    return a;
+}
+
+// Throw if views of the output buffers are alive
+static void check_no_views(PyBMRestore &X)
+{
+    if (X.m_nviews > 0){
+        throw std::runtime_error("Output views are alive; copy and delete "
+                                 "them before simulating again");
+    }
+}
+
+PYBIND11_MODULE(bmrstr, m)
+{
+    m.doc() = "Brownian Motion Restore sampler";
+    m.attr("VARIATE_BATCH") = VARIATE_BATCH;
+    m.attr("VARIATE_THREAD") = VARIATE_THREAD;
+    
+    py::class_<LogPost>(m, "LogPost")
+        .def(py::init([](int dimension, farray data, std::string target){
+                 return make_log_post(dimension, to_mat(data), target);
+             }),
+             py::arg("dimension"), py::arg("data"), py::arg("target"))
+        .def("get_dimension", &LogPost::get_dimension)
+        .def("log_dens", [](LogPost &self, farray state){
+                 arma::vec x(state.data(), state.size());
+                 return self.log_dens(x);
+             });
+    
+    py::class_<RegenDist>(m, "RegenDist")
+        .def(py::init([](int dimension, farray data, std::string dist){
+                 return make_regen_dist(dimension, to_mat(data), dist);
+             }),
+             py::arg("dimension"), py::arg("data"), py::arg("dist"))
+        .def("get_dimension", &RegenDist::get_dimension);
+    
+    py::class_<PyBMRestore>(m, "BMRestore")
+        .def(py::init<LogPost, RegenDist, double, double, int, double>(),
+             py::arg("posterior"), py::arg("regen_dist"), py::arg("logC"),
+             py::arg("kappa_bar"), py::arg("ntours") = 10000,
+             py::arg("output_rate") = 1.0)
+        .def("set_seed", idle(&BMRestore::set_seed))
+        .def("set_prefetch", idle(&BMRestore::set_prefetch),
+             py::arg("mode"), py::arg("capacity") = 4096)
+        .def("set_rqmc", idle(&BMRestore::set_rqmc),
+             py::arg("rqmc"), py::arg("scramble_seed") = 0)
+        .def("set_output_precision",
+             idle(&BMRestore::set_output_precision))
+        .def("set_ntours", idle(&BMRestore::set_ntours))
+        .def("set_output_rate", idle(&BMRestore::set_output_rate))
+        .def("set_logC", idle(&BMRestore::set_logC))
+        .def("set_kappa_bar", idle(&BMRestore::set_kappa_bar))
+        .def("set_covariance", [](PyBMRestore &self, farray cov){
+                 check_idle(self);
+                 self.set_covariance(to_mat(cov));
+             })
+        // Ornstein-Uhlenbeck underlying process with the given invariant
+        // mean and covariance
+        .def("set_ornstein_uhlenbeck", [](PyBMRestore &self, farray mean,
+                                          farray cov){
+                 check_idle(self);
+                 arma::vec m(mean.data(), mean.size());
+                 self.set_diffusion(
+                     std::make_shared<OrnsteinUhlenbeck>(m, to_mat(cov)));
+             })
+        .def("estimate_covariance", [](PyBMRestore &self,
+                                       int pilot_ntours){
+                 check_no_views(self);
+                 BusyGuard busy(self);
+                 py::gil_scoped_release release;
+                 self.estimate_covariance(pilot_ntours);
+             })
+        .def("gen_fixed_ntours", [](PyBMRestore &self){
+                 check_no_views(self);
+                 BusyGuard busy(self);
+                 py::gil_scoped_release release;
+                 self.gen_fixed_ntours();
+             })
+        .def("get_dimension", idle(&BMRestore::get_dimension))
+        .def("get_nevals", idle(&BMRestore::get_nevals))
+        .def("get_noutputs", idle(&BMRestore::get_noutputs))
+        .def("get_ntours_completed",
+             idle(&BMRestore::get_ntours_completed))
+        .def("get_npotential_regen",
+             idle(&BMRestore::get_npotential_regen))
+        .def("get_nsqueezed", idle(&BMRestore::get_nsqueezed))
+        .def("set_control_variates",
+             idle(&BMRestore::set_control_variates))
+        // Returns (mean, plain_mean, var_ratio)
+        .def("zv_mean", [](PyBMRestore &self){
+                 check_idle(self);
+                 arma::vec mean, plain_mean, var_ratio;
+                 self.zv_mean(mean, plain_mean, var_ratio);
+                 return py::make_tuple(
+                     py::array_t<double>(mean.n_elem, mean.memptr()),
+                     py::array_t<double>(plain_mean.n_elem,
+                                         plain_mean.memptr()),
+                     py::array_t<double>(var_ratio.n_elem,
+                                         var_ratio.memptr()));
+             })
+        .def("ess", [](PyBMRestore &self){
+                 check_idle(self);
+                 arma::vec ess;
+                 self.ess(ess);
+                 return py::array_t<double>(ess.n_elem, ess.memptr());
+             })
+        // noutputs x dimension view of the output states, float32 if
+        // states are stored in single precision
+        .def("output_states", [](py::object self) -> py::array {
+                 PyBMRestore &X = self.cast<PyBMRestore&>();
+                 check_idle(X);
+                 py::ssize_t n = X.get_noutputs();
+                 py::ssize_t d = X.get_dimension();
+                 if (X.is_output_single()){
+                     py::ssize_t s = sizeof(float);
+                     return read_only(py::array_t<float>(
+                         {n, d}, {d * s, s},
+                         X.get_output_states_data_single(), view_base(self)));
+                 }
+                 py::ssize_t s = sizeof(double);
+                 return read_only(py::array_t<double>(
+                     {n, d}, {d * s, s},
+                     X.get_output_states_data(), view_base(self)));
+             })
+        .def("output_times", [](py::object self){
+                 PyBMRestore &X = self.cast<PyBMRestore&>();
+                 check_idle(X);
+                 return read_only(py::array_t<double>(
+                     X.get_noutputs(), X.get_output_times_data(),
+                     view_base(self)));
+             })
+        .def("output_tour_number", [](py::object self){
+                 PyBMRestore &X = self.cast<PyBMRestore&>();
+                 check_idle(X);
+                 return read_only(py::array_t<int>(
+                     X.get_noutputs(), X.get_output_tour_number_data(),
+                     view_base(self)));
+             });
+}
@@ -0,0 +1,20 @@
+# Build the Python bindings with
+#   pip install ./bindings/python
+# Requires pybind11 and Armadillo.
+import os
+from setuptools import setup
+from pybind11.setup_helpers import Pybind11Extension
+
+root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+src = ["bmrstr.cpp", "diffusion.cpp", "log_post.cpp", "logistic.cpp",
+       "mvg.cpp", "regen_dist.cpp", "sobol.cpp", "variate_stream.cpp"]
+
+ext = Pybind11Extension(
+    "bmrstr",
+    ["bmrstr_py.cpp"] + [os.path.join(root, "src", f) for f in src],
+    include_dirs=[os.path.join(root, "include")],
+    libraries=["armadillo"],
+    cxx_std=17,
+)
+
+setup(name="bmrstr", version="0.1", ext_modules=[ext])
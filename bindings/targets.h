@@ -0,0 +1,64 @@
+/* Named targets and regeneration distributions for the language bindings
+ *
+ * Bindings construct LogPost and RegenDist objects from compiled functions,
+ * so that sampling never calls back into the interpreter.
+ */
+#ifndef BINDINGS_TARGETS_H
+#define BINDINGS_TARGETS_H
+
+#include "log_post.h"
+#include "logistic.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include <armadillo>
+#include <stdexcept>
+#include <string>
+
+/* Construct a LogPost from the name of a target
+ *
+ * "gaussian" : zero-mean Gaussian, data is the precision matrix
+ * "logistic" : logistic regression, data holds responses then covariates
+ */
+inline LogPost make_log_post(int dimension,
+                             const arma::mat &data,
+                             const std::string &target)
+{
+    if (target == "gaussian"){
+        LogPost post(dimension, data, ld_mvg_prec, grad_ld_mvg_prec,
+                     lap_ld_mvg_prec);
+        post.set_hess_log_dens(hess_ld_mvg_prec);
+        return post;
+    } else if (target == "logistic"){
+        LogPost post(dimension, data, ld_logistic, grad_ld_logistic,
+                     lap_ld_logistic);
+        post.set_hess_log_dens(hess_ld_logistic);
+        return post;
+    }
+    throw std::invalid_argument("Unknown target: " + target);
+}
+
+/* Construct a RegenDist from the name of a distribution. Both have an
+ * inverse transform, for RQMC.
+ *
+ * "gaussian_iso"     : standard Gaussian, data is unused
+ * "gaussian_iso_mix" : mixture of isotropic Gaussians, data as in mvg.h.
+ *                      Samples are drawn in batches.
+ */
+inline RegenDist make_regen_dist(int dimension,
+                                 const arma::mat &data,
+                                 const std::string &dist)
+{
+    if (dist == "gaussian_iso"){
+        RegenDist regen(dimension, data, ld_mvg_iso, rmvg_iso);
+        regen.set_rmu_inverse(qmvg_iso, dimension);
+        return regen;
+    } else if (dist == "gaussian_iso_mix"){
+        RegenDist regen(dimension, data, ld_mvg_iso_mix, rmvg_iso_mix);
+        regen.set_rmu_batch(rmvg_iso_mix_batch);
+        regen.set_rmu_inverse(qmvg_iso_mix, dimension + 1);
+        return regen;
+    }
+    throw std::invalid_argument("Unknown regeneration distribution: " + dist);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/* Observers of BMRestore
+ *
+ * Target is the bivariate Gaussian of bvg.cpp. A Poisson observer
+ * accumulates the second moment of the first component at rate
+ * OBSERVER_RATE, without storing states, and a timed observer prints the
+ * progress of the process every CHECKPOINT_PERIOD units of time. Both are
+ * superposed with the clocks of potential regeneration and output, so each
+ * step of the process costs one exponential and one uniform draw however
+ * many observers are added.
+ */
+
+#include "bmrstr.h"
+#include "log_post.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include <armadillo>
+#include <iostream>
+
+#define LOGC 2.07
+#define KAPPA_BAR 100.0
+#define NTOURS 10000
+#define OUTPUT_RATE 1.0
+#define OBSERVER_RATE 10.0
+#define CHECKPOINT_PERIOD 2000.0
+
+// Running sum of the squared first component and number of observations
+struct Moment
+{
+    double sum;
+    int n;
+};
+
+// Accumulate the squared first component into the Moment pointed to by data
+void observe_moment(const arma::vec &state, double t, int tour, void *data);
+
+// Print the time and tour number
+void checkpoint(const arma::vec &state, double t, int tour, void *data);
+
+int main()
+{
+    int d = 2;
+    arma::mat targ_cov({{1.2, 0.4},
+                        {0.4, 0.8}});
+    arma::mat targ_prec = arma::inv_sympd(targ_cov);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    
+    BMRestore X(gauss, mu, LOGC, KAPPA_BAR, NTOURS, OUTPUT_RATE);
+    Moment moment = {0, 0};
+    X.add_poisson_observer(OBSERVER_RATE, observe_moment, &moment);
+    X.add_timed_observer(CHECKPOINT_PERIOD, CHECKPOINT_PERIOD, checkpoint,
+                         nullptr);
+    X.gen_fixed_ntours();
+    
+    std::cout << "Observations: " << moment.n << '\n';
+    std::cout << "Estimate of E[X1^2]: " << moment.sum / moment.n
+              << " (true value " << targ_cov(0, 0) << ")\n";
+    
+    return 0;
+}
+
+void observe_moment(const arma::vec &state, double t, int tour, void *data)
+{
+    Moment *moment = (Moment*) data;
+    moment->sum += state(0) * state(0);
+    moment->n++;
+}
+
+void checkpoint(const arma::vec &state, double t, int tour, void *data)
+{
+    std::cout << "t = " << t << ", tour " << tour << '\n';
+}
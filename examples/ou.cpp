@@ -0,0 +1,110 @@
+/* Compare Brownian motion and Ornstein-Uhlenbeck underlying processes
+ *
+ * Targets are the bivariate Gaussian of bvg.cpp and a Bayesian logistic
+ * regression on simulated data. The Ornstein-Uhlenbeck process is centred
+ * at a Laplace approximation of the target, with the inverse Hessian at the
+ * mode as its covariance. Prints the number of evaluations per tour, the
+ * smallest effective sample size over components and the effective sample
+ * size per second.
+ */
+
+#include "bmrstr.h"
+#include "diffusion.h"
+#include "log_post.h"
+#include "logistic.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include <armadillo>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+#define LOGC_GAUSS 2.07
+#define KAPPA_BAR_GAUSS 100.0
+#define LOGC_LOGISTIC 0.0
+#define KAPPA_BAR_LOGISTIC 100.0
+#define NTOURS 10000
+#define OUTPUT_RATE 1.0
+#define NOBS 200
+
+// Run X, then print evaluations per tour and effective sample sizes
+void report(BMRestore &X, std::string label);
+
+// Set an Ornstein-Uhlenbeck process at the Laplace approximation of post
+void use_laplace_ou(BMRestore &X, LogPost &post);
+
+int main()
+{
+    int d = 2;
+    
+    // Gaussian target
+    arma::mat targ_cov({{1.2, 0.4},
+                        {0.4, 0.8}});
+    arma::mat targ_prec = arma::inv_sympd(targ_cov);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    gauss.set_hess_log_dens(hess_ld_mvg_prec);
+    
+    // Logistic regression target
+    std::mt19937_64 gen(1);
+    std::normal_distribution<double> rnorm(0.0, 1.0);
+    std::uniform_real_distribution<double> runif(0.0, 1.0);
+    arma::vec beta({0.5, -1.0});
+    arma::mat data(NOBS, d+1);
+    for (int i = 0; i < NOBS; i++){
+        data(i, 1) = rnorm(gen);
+        data(i, 2) = rnorm(gen);
+        double eta = beta(0) * data(i, 1) + beta(1) * data(i, 2);
+        data(i, 0) = runif(gen) < 1.0 / (1.0 + exp(-eta));
+    }
+    LogPost logistic(d, data, ld_logistic, grad_ld_logistic, lap_ld_logistic);
+    logistic.set_hess_log_dens(hess_ld_logistic);
+    
+    // Regeneration distribution has identity covariance matrix
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    
+    BMRestore X1(gauss, mu, LOGC_GAUSS, KAPPA_BAR_GAUSS, NTOURS, OUTPUT_RATE);
+    report(X1, "Gaussian, Brownian motion");
+    
+    BMRestore X2(gauss, mu, LOGC_GAUSS, KAPPA_BAR_GAUSS, NTOURS, OUTPUT_RATE);
+    use_laplace_ou(X2, gauss);
+    report(X2, "Gaussian, Ornstein-Uhlenbeck");
+    
+    BMRestore X3(logistic, mu, LOGC_LOGISTIC, KAPPA_BAR_LOGISTIC, NTOURS,
+                 OUTPUT_RATE);
+    report(X3, "Logistic, Brownian motion");
+    
+    BMRestore X4(logistic, mu, LOGC_LOGISTIC, KAPPA_BAR_LOGISTIC, NTOURS,
+                 OUTPUT_RATE);
+    use_laplace_ou(X4, logistic);
+    report(X4, "Logistic, Ornstein-Uhlenbeck");
+    
+    return 0;
+}
+
+void use_laplace_ou(BMRestore &X, LogPost &post)
+{
+    arma::vec mode(post.get_dimension(), arma::fill::zeros);
+    arma::mat cov;
+    if (laplace_approx(post, mode, cov)){
+        X.set_diffusion(std::make_shared<OrnsteinUhlenbeck>(mode, cov));
+    }
+}
+
+void report(BMRestore &X, std::string label)
+{
+    auto start = std::chrono::steady_clock::now();
+    X.gen_fixed_ntours();
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+    
+    arma::vec ess;
+    X.ess(ess);
+    std::cout << label << '\n'
+              << "  evaluations per tour : "
+              << (double) X.get_nevals() / X.get_ntours_completed() << '\n'
+              << "  min ESS              : " << ess.min() << '\n'
+              << "  min ESS per second   : " << ess.min() / secs << '\n';
+}
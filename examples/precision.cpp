@@ -0,0 +1,87 @@
+/* Accuracy of BMRestore with output states stored in single precision
+ *
+ * Target is a standard Gaussian in DIM dimensions. The sampler is run
+ * twice with the same seed, storing output states as doubles and then as
+ * floats. The simulated paths are identical, so the estimates differ only
+ * by the rounding of the stored states. Prints the largest difference in
+ * the estimated means against the smallest Monte Carlo standard error,
+ * and the memory used by the output states in each precision.
+ */
+
+#include "bmrstr.h"
+#include "log_post.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include <armadillo>
+#include <cmath>
+#include <iostream>
+
+#define DIM 20
+#define LOGC 21.0
+#define KAPPA_BAR 40.0
+#define NTOURS 10000
+#define OUTPUT_RATE 1.0
+#define SEED 1
+
+// Mean of the output states, read back in double precision
+void output_mean(BMRestore &X, arma::vec &mean);
+
+int main()
+{
+    int d = DIM;
+    arma::mat targ_prec(d, d, arma::fill::eye);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    
+    BMRestore X1(gauss, mu, LOGC, KAPPA_BAR, NTOURS, OUTPUT_RATE);
+    X1.set_seed(SEED);
+    X1.gen_fixed_ntours();
+    
+    BMRestore X2(gauss, mu, LOGC, KAPPA_BAR, NTOURS, OUTPUT_RATE);
+    X2.set_seed(SEED);
+    X2.set_output_precision(1);
+    X2.gen_fixed_ntours();
+    
+    arma::vec mean1, mean2, ess;
+    output_mean(X1, mean1);
+    output_mean(X2, mean2);
+    X1.ess(ess);
+    
+    // Standard error of each component, the target has unit variances
+    arma::vec se = 1.0 / arma::sqrt(ess);
+    int n = X1.get_noutputs();
+    
+    std::cout << "Output states: " << n << '\n';
+    std::cout << "Max |mean difference|: "
+              << arma::max(arma::abs(mean1 - mean2)) << '\n';
+    std::cout << "Min Monte Carlo standard error: " << se.min() << '\n';
+    std::cout << "Output state memory (MB), double: "
+              << n * d * sizeof(double) / 1e6 << ", single: "
+              << n * d * sizeof(float) / 1e6 << '\n';
+    
+    return 0;
+}
+
+void output_mean(BMRestore &X, arma::vec &mean)
+{
+    int n = X.get_noutputs();
+    int d = X.get_dimension();
+    mean.zeros(d);
+    if (X.is_output_single()){
+        const float *x = X.get_output_states_data_single();
+        for (int i = 0; i < n; i++){
+            for (int j = 0; j < d; j++){
+                mean(j) += x[i * d + j];
+            }
+        }
+    } else {
+        const double *x = X.get_output_states_data();
+        for (int i = 0; i < n; i++){
+            for (int j = 0; j < d; j++){
+                mean(j) += x[i * d + j];
+            }
+        }
+    }
+    mean /= n;
+}
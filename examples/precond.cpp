@@ -0,0 +1,101 @@
+/* Compare BMRestore with and without a preconditioned Brownian motion
+ *
+ * Targets are an ill-conditioned bivariate Gaussian with covariance matrix
+ *      10.0, 2.85
+ *      2.85, 1.0
+ * and a Bayesian logistic regression on simulated data with badly scaled
+ * covariates. For each target, the sampler is run once with an isotropic
+ * Brownian motion and once with a covariance matrix estimated from a pilot
+ * run. Prints the number of evaluations per tour, the smallest effective
+ * sample size over components and the effective sample size per second.
+ */
+
+#include "bmrstr.h"
+#include "log_post.h"
+#include "logistic.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include <armadillo>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+#define LOGC_GAUSS 3.0
+#define KAPPA_BAR_GAUSS 200.0
+#define LOGC_LOGISTIC 0.0
+#define KAPPA_BAR_LOGISTIC 500.0
+#define NTOURS 10000
+#define PILOT_NTOURS 1000
+#define OUTPUT_RATE 1.0
+#define NOBS 200
+
+// Run X, then print evaluations per tour and effective sample sizes
+void report(BMRestore &X, std::string label);
+
+int main()
+{
+    int d = 2;
+    
+    // Ill-conditioned Gaussian target
+    arma::mat targ_cov({{10.0, 2.85},
+                        {2.85, 1.0}});
+    arma::mat targ_prec = arma::inv_sympd(targ_cov);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    gauss.set_hess_log_dens(hess_ld_mvg_prec);
+    
+    // Logistic regression target, second covariate on a much larger scale
+    std::mt19937_64 gen(1);
+    std::normal_distribution<double> rnorm(0.0, 1.0);
+    std::uniform_real_distribution<double> runif(0.0, 1.0);
+    arma::vec beta({0.5, -0.05});
+    arma::mat data(NOBS, d+1);
+    for (int i = 0; i < NOBS; i++){
+        data(i, 1) = rnorm(gen);
+        data(i, 2) = 10.0 * rnorm(gen);
+        double eta = beta(0) * data(i, 1) + beta(1) * data(i, 2);
+        data(i, 0) = runif(gen) < 1.0 / (1.0 + exp(-eta));
+    }
+    LogPost logistic(d, data, ld_logistic, grad_ld_logistic, lap_ld_logistic);
+    logistic.set_hess_log_dens(hess_ld_logistic);
+    
+    // Regeneration distribution has identity covariance matrix
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    
+    BMRestore X1(gauss, mu, LOGC_GAUSS, KAPPA_BAR_GAUSS, NTOURS, OUTPUT_RATE);
+    report(X1, "Gaussian, isotropic");
+    
+    BMRestore X2(gauss, mu, LOGC_GAUSS, KAPPA_BAR_GAUSS, NTOURS, OUTPUT_RATE);
+    X2.estimate_covariance(PILOT_NTOURS);
+    report(X2, "Gaussian, preconditioned");
+    
+    BMRestore X3(logistic, mu, LOGC_LOGISTIC, KAPPA_BAR_LOGISTIC, NTOURS,
+                 OUTPUT_RATE);
+    report(X3, "Logistic, isotropic");
+    
+    BMRestore X4(logistic, mu, LOGC_LOGISTIC, KAPPA_BAR_LOGISTIC, NTOURS,
+                 OUTPUT_RATE);
+    X4.estimate_covariance(PILOT_NTOURS);
+    report(X4, "Logistic, preconditioned");
+    
+    return 0;
+}
+
+void report(BMRestore &X, std::string label)
+{
+    int nevals_pilot = X.get_nevals();
+    auto start = std::chrono::steady_clock::now();
+    X.gen_fixed_ntours();
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+    
+    arma::vec ess;
+    X.ess(ess);
+    std::cout << label << '\n'
+              << "  evaluations per tour : "
+              << (double) (X.get_nevals() - nevals_pilot)
+                 / X.get_ntours_completed() << '\n'
+              << "  min ESS              : " << ess.min() << '\n'
+              << "  min ESS per second   : " << ess.min() / secs << '\n';
+}
@@ -0,0 +1,52 @@
+/* Throughput of BMRestore with and without prefetched random variates
+ *
+ * The target is a standard Gaussian in dimension 10, for which evaluating
+ * the regeneration rate is cheap and drawing random variates dominates.
+ * Prints the number of potential regeneration events simulated per second
+ * when variates are drawn directly, refilled in blocks and refilled by a
+ * producer thread.
+ */
+
+#include "bmrstr.h"
+#include "log_post.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include "variate_stream.h"
+#include <armadillo>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#define DIMENSION 10
+#define LOGC 0.0
+#define KAPPA_BAR 100.0
+#define NTOURS 20000
+#define OUTPUT_RATE 1.0
+#define SEED 1
+
+int main()
+{
+    int d = DIMENSION;
+    arma::mat targ_prec(d, d, arma::fill::eye);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    RegenDist mu(d, targ_prec, ld_mvg_iso, rmvg_iso);
+    
+    std::string labels[3] = {"direct", "batch", "thread"};
+    int modes[3] = {0, VARIATE_BATCH, VARIATE_THREAD};
+    for (int i = 0; i < 3; i++){
+        BMRestore X(gauss, mu, LOGC, KAPPA_BAR, NTOURS, OUTPUT_RATE);
+        X.set_seed(SEED);
+        X.set_prefetch(modes[i]);
+        
+        auto start = std::chrono::steady_clock::now();
+        X.gen_fixed_ntours();
+        auto end = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(end - start).count();
+        
+        std::cout << labels[i] << " : "
+                  << X.get_npotential_regen() / secs
+                  << " potential regenerations per second\n";
+    }
+    
+    return 0;
+}
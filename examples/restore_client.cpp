@@ -0,0 +1,84 @@
+/* Per-job latency of the sampling service against a cold start
+ *
+ * Usage:
+ *   restore_client.out SOCKET_PATH [NJOBS] [NTOURS]
+ *
+ * Submits NJOBS small jobs to restore_server.out listening on SOCKET_PATH,
+ * then runs the same number of jobs with "restore_server.out --cold", and
+ * prints the mean latency per job of each.
+ */
+
+#include "sampling_service.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define LOGC 2.07
+#define KAPPA_BAR 100.0
+#define OUTPUT_RATE 1.0
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2){
+        std::cerr << "Usage: " << argv[0]
+                  << " SOCKET_PATH [NJOBS] [NTOURS]\n";
+        return 1;
+    }
+    int njobs = argc > 2 ? std::atoi(argv[2]) : 100;
+    int ntours = argc > 3 ? std::atoi(argv[3]) : 100;
+    
+    int fd = service_connect(argv[1]);
+    if (fd < 0){
+        std::cerr << "Couldn't connect to " << argv[1] << '\n';
+        return 1;
+    }
+    
+    JobRequest request;
+    std::memset(&request, 0, sizeof(request));
+    std::strcpy(request.target, "bvg");
+    request.ntours = ntours;
+    request.logC = LOGC;
+    request.kappa_bar = KAPPA_BAR;
+    request.output_rate = OUTPUT_RATE;
+    request.output = SERVICE_OUTPUT_STATES;
+    
+    JobHeader header;
+    std::vector<double> states, times;
+    std::vector<int> tours;
+    
+    // Warm jobs through the service
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < njobs; i++){
+        request.seed = i;
+        request.id = i;
+        if (!service_submit(fd, request, header, states, times, tours) ||
+            header.status != SERVICE_OK){
+            std::cerr << "Job " << i << " failed\n";
+            return 1;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double warm = std::chrono::duration<double>(end - start).count() / njobs;
+    close(fd);
+    
+    // Cold starts of the same jobs
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < njobs; i++){
+        std::string cmd = "./restore_server.out --cold " + std::to_string(i)
+                          + " " + std::to_string(ntours) + " > /dev/null";
+        if (std::system(cmd.c_str()) != 0){
+            std::cerr << "Cold job " << i << " failed\n";
+            return 1;
+        }
+    }
+    end = std::chrono::steady_clock::now();
+    double cold = std::chrono::duration<double>(end - start).count() / njobs;
+    
+    std::cout << "Mean latency per job, service    : " << warm << " s\n"
+              << "Mean latency per job, cold start : " << cold << " s\n";
+    return 0;
+}
@@ -0,0 +1,58 @@
+/* Sampling service for the bivariate Gaussian of bvg.cpp
+ *
+ * Usage:
+ *   restore_server.out SOCKET_PATH [NTHREADS]
+ *       Keep the target resident and serve jobs on SOCKET_PATH.
+ *   restore_server.out --cold SEED NTOURS
+ *       Build the target, run a single job and exit, as a cold-start
+ *       baseline for restore_client.out.
+ */
+
+#include "bmrstr.h"
+#include "log_post.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include "sampling_service.h"
+#include <armadillo>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#define LOGC 2.07
+#define KAPPA_BAR 100.0
+#define OUTPUT_RATE 1.0
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2){
+        std::cerr << "Usage: " << argv[0] << " SOCKET_PATH [NTHREADS]\n"
+                  << "       " << argv[0] << " --cold SEED NTOURS\n";
+        return 1;
+    }
+    
+    int d = 2;
+    arma::mat targ_cov({{1.2, 0.4},
+                        {0.4, 0.8}});
+    arma::mat targ_prec = arma::inv_sympd(targ_cov);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    
+    if (std::string(argv[1]) == "--cold"){
+        if (argc < 4){
+            std::cerr << "Usage: " << argv[0] << " --cold SEED NTOURS\n";
+            return 1;
+        }
+        BMRestore X(gauss, mu, LOGC, KAPPA_BAR, std::atoi(argv[3]),
+                    OUTPUT_RATE);
+        X.set_seed(std::atoi(argv[2]));
+        X.gen_fixed_ntours();
+        X.print_output_states();
+        return 0;
+    }
+    
+    int nthreads = argc > 2 ? std::atoi(argv[2]) : 4;
+    SamplingService service(argv[1], nthreads);
+    service.register_target("bvg", gauss, mu);
+    return service.run() ? 0 : 1;
+}
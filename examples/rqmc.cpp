@@ -0,0 +1,72 @@
+/* Error decay of BMRestore with independent and RQMC rebirth states
+ *
+ * Target is the bivariate Gaussian of bvg.cpp. For increasing numbers of
+ * tours, the mean of the first component is estimated from NREPS
+ * independent replicates, drawing rebirth states either independently or
+ * from a scrambled Sobol sequence with a different scramble per replicate.
+ * Prints the root mean squared error of each against the true mean of 0.
+ */
+
+#include "bmrstr.h"
+#include "log_post.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include <armadillo>
+#include <cmath>
+#include <iostream>
+
+#define LOGC 2.07
+#define KAPPA_BAR 100.0
+#define OUTPUT_RATE 1.0
+#define NREPS 20
+#define MIN_LOG2_NTOURS 8
+#define MAX_LOG2_NTOURS 14
+
+// Mean of the first component of the output states
+double output_mean(BMRestore &X);
+
+int main()
+{
+    int d = 2;
+    arma::mat targ_cov({{1.2, 0.4},
+                        {0.4, 0.8}});
+    arma::mat targ_prec = arma::inv_sympd(targ_cov);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    mu.set_rmu_inverse(qmvg_iso, d);
+    
+    std::cout << "ntours, RMSE independent, RMSE RQMC\n";
+    for (int m = MIN_LOG2_NTOURS; m <= MAX_LOG2_NTOURS; m++){
+        int ntours = 1 << m;
+        double mse_iid = 0, mse_rqmc = 0;
+        for (int r = 0; r < NREPS; r++){
+            BMRestore X1(gauss, mu, LOGC, KAPPA_BAR, ntours, OUTPUT_RATE);
+            X1.set_seed(r);
+            X1.gen_fixed_ntours();
+            mse_iid += pow(output_mean(X1), 2) / NREPS;
+            
+            BMRestore X2(gauss, mu, LOGC, KAPPA_BAR, ntours, OUTPUT_RATE);
+            X2.set_seed(r);
+            X2.set_rqmc(1, r);
+            X2.gen_fixed_ntours();
+            mse_rqmc += pow(output_mean(X2), 2) / NREPS;
+        }
+        std::cout << ntours << ", " << sqrt(mse_iid) << ", "
+                  << sqrt(mse_rqmc) << '\n';
+    }
+    
+    return 0;
+}
+
+double output_mean(BMRestore &X)
+{
+    int n = X.get_noutputs();
+    int d = X.get_dimension();
+    const double *x = X.get_output_states_data();
+    double sum = 0;
+    for (int i = 0; i < n; i++){
+        sum += x[i * d];
+    }
+    return sum / n;
+}
@@ -0,0 +1,58 @@
+/* Tune BMRestore for the bivariate Gaussian of bvg.cpp with a Sweep
+ *
+ * Runs every combination of the values of logC, kappa_bar, regeneration
+ * distribution, output rate and preconditioning below concurrently,
+ * stopping configurations that fall behind, then prints a table of their
+ * performance. Preconditioned configurations share the covariance of one
+ * pilot run.
+ */
+
+#include "log_post.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include "sweep.h"
+#include <armadillo>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NTOURS_PER_STAGE 2000
+#define NSTAGES 5
+#define KEEP_FRACTION 0.5
+#define PILOT_NTOURS 1000
+#define PILOT_LOGC 2.07
+#define PILOT_KAPPA_BAR 100.0
+
+int main()
+{
+    int d = 2;
+    arma::mat targ_cov({{1.2, 0.4},
+                        {0.4, 0.8}});
+    arma::mat targ_prec = arma::inv_sympd(targ_cov);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    gauss.set_hess_log_dens(hess_ld_mvg_prec);
+    
+    // Standard Gaussian, and an equal mixture of two wider Gaussians
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu_iso(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    arma::mat mix({{0.5, 0.5},
+                   {-0.5, 0.5},
+                   {-0.5, 0.5},
+                   {1.2, 1.2}});
+    RegenDist mu_mix(d, mix, ld_mvg_iso_mix, rmvg_iso_mix);
+    mu_mix.set_rmu_batch(rmvg_iso_mix_batch);
+    
+    int nthreads = std::thread::hardware_concurrency();
+    Sweep sweep(gauss, nthreads > 0 ? nthreads : 1);
+    sweep.set_pilot(PILOT_NTOURS, PILOT_LOGC, PILOT_KAPPA_BAR, mu_iso);
+    sweep.add_grid({1.0, 2.07, 3.0},
+                   {50.0, 100.0, 200.0},
+                   {mu_iso, mu_mix},
+                   {"iso", "mixture"},
+                   {1.0, 10.0},
+                   {0, 1});
+    sweep.run(NTOURS_PER_STAGE, NSTAGES, KEEP_FRACTION);
+    sweep.print_table();
+    
+    return 0;
+}
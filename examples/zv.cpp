@@ -0,0 +1,99 @@
+/* Zero-variance control variates from the evaluations made by BMRestore
+ *
+ * Targets are the bivariate Gaussian of bvg.cpp and a Bayesian logistic
+ * regression on simulated data. For each target, the sampler is run with
+ * and without recording control variates. Prints the estimates of the
+ * mean with and without control variates, the ratio of their asymptotic
+ * variances, estimated from per-tour sums, and the gain in variance
+ * reduction per CPU-second, which accounts for the cost of recording.
+ */
+
+#include "bmrstr.h"
+#include "log_post.h"
+#include "logistic.h"
+#include "mvg.h"
+#include "regen_dist.h"
+#include <armadillo>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+#define LOGC_GAUSS 2.07
+#define KAPPA_BAR_GAUSS 100.0
+#define LOGC_LOGISTIC 0.0
+#define KAPPA_BAR_LOGISTIC 100.0
+#define NTOURS 10000
+#define OUTPUT_RATE 1.0
+#define NOBS 200
+#define SEED 1
+
+// Compare runs of X with and without control variates
+void report(LogPost &post, RegenDist &mu, double logC, double kappa_bar,
+            std::string label);
+
+int main()
+{
+    int d = 2;
+    
+    // Gaussian target
+    arma::mat targ_cov({{1.2, 0.4},
+                        {0.4, 0.8}});
+    arma::mat targ_prec = arma::inv_sympd(targ_cov);
+    LogPost gauss(d, targ_prec, ld_mvg_prec, grad_ld_mvg_prec, lap_ld_mvg_prec);
+    
+    // Logistic regression target
+    std::mt19937_64 gen(SEED);
+    std::normal_distribution<double> rnorm(0.0, 1.0);
+    std::uniform_real_distribution<double> runif(0.0, 1.0);
+    arma::vec beta({0.5, -1.0});
+    arma::mat data(NOBS, d+1);
+    for (int i = 0; i < NOBS; i++){
+        data(i, 1) = rnorm(gen);
+        data(i, 2) = rnorm(gen);
+        double eta = beta(0) * data(i, 1) + beta(1) * data(i, 2);
+        data(i, 0) = runif(gen) < 1.0 / (1.0 + exp(-eta));
+    }
+    LogPost logistic(d, data, ld_logistic, grad_ld_logistic, lap_ld_logistic);
+    
+    // Regeneration distribution has identity covariance matrix
+    arma::mat redundant_mat(d, d, arma::fill::eye);
+    RegenDist mu(d, redundant_mat, ld_mvg_iso, rmvg_iso);
+    
+    report(gauss, mu, LOGC_GAUSS, KAPPA_BAR_GAUSS, "Gaussian");
+    report(logistic, mu, LOGC_LOGISTIC, KAPPA_BAR_LOGISTIC, "Logistic");
+    
+    return 0;
+}
+
+void report(LogPost &post, RegenDist &mu, double logC, double kappa_bar,
+            std::string label)
+{
+    BMRestore X1(post, mu, logC, kappa_bar, NTOURS, OUTPUT_RATE);
+    X1.set_seed(SEED);
+    auto start = std::chrono::steady_clock::now();
+    X1.gen_fixed_ntours();
+    auto end = std::chrono::steady_clock::now();
+    double secs_plain = std::chrono::duration<double>(end - start).count();
+    
+    BMRestore X2(post, mu, logC, kappa_bar, NTOURS, OUTPUT_RATE);
+    X2.set_seed(SEED);
+    X2.set_control_variates(1);
+    start = std::chrono::steady_clock::now();
+    X2.gen_fixed_ntours();
+    end = std::chrono::steady_clock::now();
+    double secs_cv = std::chrono::duration<double>(end - start).count();
+    
+    arma::vec mean, plain_mean, var_ratio;
+    X2.zv_mean(mean, plain_mean, var_ratio);
+    
+    std::cout << label << '\n';
+    for (int j = 0; j < post.get_dimension(); j++){
+        std::cout << "  component " << j
+                  << ": plain mean " << plain_mean(j)
+                  << ", control variate mean " << mean(j)
+                  << ", variance ratio " << var_ratio(j)
+                  << ", gain per CPU-second "
+                  << secs_plain / (secs_cv * var_ratio(j)) << '\n';
+    }
+}
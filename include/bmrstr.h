@@ -1,16 +1,34 @@
 /* Brownian Motion Restore simulation in multiple dimensions
+ *
+ * The underlying process is a Brownian motion by default, and can be
+ * replaced by any Diffusion.
  */
 #ifndef BMRSTR_H
 #define BMRSTR_H
 
+#include "diffusion.h"
 #include "log_post.h"
 #include "regen_dist.h"
+#include "sobol.h"
+#include "variate_stream.h"
 #include <armadillo>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
 #include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
+// Observer of the process, called with the current state, time and tour
+// number and the pointer given when it was added. It must not modify the
+// sampler.
+typedef void (*Observer)(const arma::vec &state,
+                         double t,
+                         int tour,
+                         void *data);
+
 class BMRestore
 {
 public:
@@ -49,12 +67,101 @@ public:
     // Should only be called once, before any random numbers are generated
     void set_seed(const unsigned int s);
     
-    // Compute the partial regeneration rate at state
+    /* Pre-generate the exponential, uniform and Gaussian variates used to
+     * simulate the process, rather than drawing them one at a time.
+     *
+     * mode     : 0 to draw variates directly (the default), VARIATE_BATCH
+     *            to refill buffers in blocks, or VARIATE_THREAD to refill
+     *            them from a producer thread.
+     * capacity : number of variates buffered of each kind, at least 2.
+     *            Otherwise the current mode is kept.
+     *
+     * Output is deterministic given the seed, but differs between mode 0
+     * and the other two modes.
+     */
+    void set_prefetch(const int mode, const int capacity = 4096);
+    
+    /* Draw rebirth states by randomised quasi-Monte Carlo
+     *
+     * rqmc          : 1 to map successive points of a scrambled Sobol
+     *                 sequence through the inverse transform of the
+     *                 regeneration distribution, one point per tour,
+     *                 0 to draw rebirth states independently.
+     * scramble_seed : seed of the scramble. Replicates with different
+     *                 seeds are independent, giving error bars.
+     */
+    void set_rqmc(const int rqmc, const unsigned int scramble_seed = 0);
+    
+    // Set the underlying process, a Brownian motion by default.
+    // Samplers may share a Diffusion. A non-isotropic process is refused
+    // unless the posterior contains hess_log_dens.
+    void set_diffusion(std::shared_ptr<Diffusion> diffusion);
+    
+    /* Set the diffusion matrix of the underlying process
+     *
+     * cov : symmetric positive definite matrix. Its Cholesky factor is
+     *       cached and used to simulate increments. Unless cov is exactly
+     *       the identity, which keeps the isotropic process, the posterior
+     *       must contain hess_log_dens.
+     */
+    void set_covariance(const arma::mat &cov);
+    
+    /* Estimate the diffusion matrix of the underlying process as the
+     * covariance of the output of a pilot run of pilot_ntours tours, then
+     * discard the output of the pilot run. Evaluations made during the
+     * pilot run are counted.
+     */
+    void estimate_covariance(const int pilot_ntours);
+    
+    // Compute the partial regeneration rate at state. For a Brownian motion
+    // with diffusion matrix cov, this is
+    // 0.5 * (gradU' cov gradU - tr(cov HessU)).
     double kappa_partial(const arma::vec &state);
     
     // Compute the regeneration rate at state
     double kappa(const arma::vec &state);
     
+    // Compute the log of the regeneration rate at state, without forming
+    // C * mu / pi explicitly. Returns -infinity if the rate is not positive.
+    double log_kappa(const arma::vec &state);
+    
+    /* Set cheap bounds on the regeneration rate
+     *
+     * kappa_bounds : sets lower and upper such that
+     *                lower <= kappa(state) <= upper. It is called at every
+     *                potential regeneration event, and kappa is only
+     *                evaluated if the bounds don't decide whether to
+     *                regenerate.
+     * data         : data to pass to kappa_bounds
+     */
+    void set_kappa_bounds(void (*kappa_bounds)(const arma::vec &state,
+                                               double &lower,
+                                               double &upper,
+                                               const arma::mat &data),
+                          const arma::mat &data);
+    
+    /* Call observer at the events of a Poisson process with the given rate
+     *
+     * The clock is superposed with those of potential regeneration and
+     * output, so an observer doesn't add random draws to the other events.
+     * Returns the index of the observer.
+     */
+    int add_poisson_observer(const double rate, Observer observer,
+                             void *data);
+    
+    /* Call observer at process time t and then every period, e.g. to write
+     * checkpoints. A period of zero calls it only once. Times are on the
+     * clock of the process, which estimate_covariance resets, so timed
+     * observers should be added after it. Returns the index of the observer.
+     */
+    int add_timed_observer(const double t, const double period,
+                           Observer observer, void *data);
+    
+    // Set a Lipschitz constant of the regeneration rate. Bounds at a
+    // potential regeneration event are then derived from the last evaluation
+    // of kappa in the current tour. Zero disables these bounds.
+    void set_kappa_lipschitz(const double lipschitz);
+    
     /* Generate fixed number of tours of Restore process
      *
      * Counts the number of evaluations of the target log-density,
@@ -76,6 +183,18 @@ public:
     void print_output_times(std::ofstream &file,
                             std::string file_name);
     
+    /* Set the precision in which output states are stored
+     *
+     * single : 1 to store output states as floats, halving their memory,
+     *          0 to store them as doubles (the default). The state of the
+     *          process, times, kappa and log-densities stay in double
+     *          precision. Must be called before simulating.
+     */
+    void set_output_precision(const int single);
+    
+    // Return indicator of whether output states are stored as floats
+    int is_output_single();
+    
     // Print output states to console
     void print_output_states();
     
@@ -92,6 +211,21 @@ public:
     void print_output_tour_number(std::ofstream &file,
                                   std::string file_name);
     
+    // Return the number of output states
+    int get_noutputs();
+    
+    /* Pointers to the output buffers, for viewing output without copying
+     *
+     * States form a column-major dimension x noutputs matrix. Times and
+     * tour numbers have one entry per output. Pointers are invalidated by
+     * any further simulation. Only the states pointer matching the output
+     * precision is non-null.
+     */
+    const double* get_output_states_data();
+    const float* get_output_states_data_single();
+    const double* get_output_times_data();
+    const int* get_output_tour_number_data();
+    
     // Get the sum of the number of evaluations of U, gradU, lapU
     int get_nevals();
     
@@ -101,10 +235,64 @@ public:
     // Return the upper bound on the regeneration rate
     double get_kappa_bar();
     
+    // Return the number of tours simulated so far
+    int get_ntours_completed();
+    
+    // Return the number of potential regeneration events
+    int get_npotential_regen();
+    
+    // Return the number of potential regeneration events decided by the
+    // bounds on kappa, without evaluating kappa
+    int get_nsqueezed();
+    
+    // Return the number of evaluations of kappa exceeding kappa_bar
+    int get_nviolations();
+    
+    /* Record zero-variance control variates at potential regeneration events
+     *
+     * At every potential regeneration event where kappa is evaluated, the
+     * state, the gradient of the energy and the second-order term of kappa
+     * are accumulated into running sums, at no extra cost in evaluations.
+     * The control variates are the gradient of the energy and
+     * gradU' cov gradU - tr(cov HessU), all with mean zero under the target.
+     * While recording, every potential regeneration event evaluates kappa,
+     * since events decided by bounds on kappa aren't a uniform sample of the
+     * process.
+     */
+    void set_control_variates(const int record);
+    
+    /* Control variate estimate of the mean of the target
+     *
+     * mean       : estimate with control variates, coefficients fitted to
+     *              all recorded events
+     * plain_mean : mean of the states at recorded events
+     * var_ratio  : per component, regenerative estimate of the asymptotic
+     *              variance of mean divided by that of plain_mean, from
+     *              the per-tour sums of completed tours
+     */
+    void zv_mean(arma::vec &mean, arma::vec &plain_mean, arma::vec &var_ratio);
+    
+    /* Regenerative estimate of the effective sample size of each component
+     * of the output states, stored in ess. Tours are independent, so the
+     * asymptotic variance of the ratio estimator of the mean is estimated
+     * from the per-tour sums of the output states.
+     */
+    void ess(arma::vec &ess);
+    
 private:
     // Random number generator
     std::mt19937_64 m_gen;
     
+    // Seed, mode and capacity of the prefetched variates
+    unsigned int m_seed;
+    int m_prefetch_mode, m_prefetch_capacity;
+    
+    // Prefetched variates, null unless set_prefetch has been called
+    std::unique_ptr<VariateStream> m_variates;
+    
+    // Gaussian distribution used when variates aren't prefetched
+    std::normal_distribution<double> m_rnorm;
+    
     // Log posterior object
     LogPost m_posterior;
     
@@ -126,15 +314,129 @@ private:
     // Output times
     std::vector<double> m_t;
     
-    // Output state
-    std::vector< arma::vec > m_x;
+    // Output states, stored contiguously: output state i occupies elements
+    // i * m_dimension, ..., (i+1) * m_dimension - 1
+    std::vector<double> m_x;
+    
+    // Output states stored as floats, laid out as m_x
+    std::vector<float> m_x_single;
+    
+    // Indicator of whether output states are stored as floats
+    int m_single_output;
+    
+    // Copy output state i into x
+    void output_state(int i, arma::vec &x);
+    
+    // Observers, their pointers, and their rates or periods
+    std::vector<Observer> m_observers;
+    std::vector<void*> m_observer_data;
+    std::vector<double> m_observer_rates;
+    
+    // Indices into m_observers of the Poisson observers
+    std::vector<int> m_poisson_observers;
+    
+    // Sum of the rates of all Poisson clocks: kappa_bar, output rate and
+    // Poisson observers
+    double m_total_rate;
+    
+    // Min-heap of the times and indices of the next timed observer events
+    std::priority_queue<std::pair<double, int>,
+                        std::vector<std::pair<double, int>>,
+                        std::greater<std::pair<double, int>>> m_timed_events;
+    
+    // Recompute m_total_rate
+    void update_total_rate();
+    
+    // Call the timed observers due before time t, simulating the process
+    // up to each of them
+    void run_timed_events(double t);
+    
+    // Call the Poisson observer chosen by v, uniform on [0, sum of their
+    // rates)
+    void run_poisson_observer(double v);
     
     // Current state
     arma::vec m_x_current;
     
-    // Simulate a Brownian Motion at time s+t, when its state at time s
-    // is 'state'
-    void bm(std::mt19937_64 &generator, arma::vec &state, double t);
+    // Underlying process
+    std::shared_ptr<Diffusion> m_diffusion;
+    
+    // Buffers for the gradient and Hessian of the energy. The Hessian is
+    // only allocated for a non-isotropic process.
+    arma::vec m_grad;
+    arma::mat m_hess;
+    
+    // Buffer for standard Gaussian increments
+    arma::vec m_noise;
+    
+    // Number of potential regeneration events, number of those decided by
+    // the bounds on kappa, number of evaluations of kappa exceeding
+    // kappa_bar, indicator of whether m_kappa_ref is valid
+    int m_npotential, m_nsqueezed, m_nviolations, m_kappa_ref_valid;
+    
+    // Lipschitz constant of kappa, kappa at state m_x_ref
+    double m_kappa_lipschitz, m_kappa_ref;
+    
+    // State at which kappa was last evaluated in the current tour
+    arma::vec m_x_ref;
+    
+    // Cheap bounds on kappa and the data passed to them
+    void (*m_kappa_bounds)(const arma::vec &state,
+                           double &lower,
+                           double &upper,
+                           const arma::mat &data);
+    arma::mat m_kappa_bounds_data;
+    
+    /* Try to decide whether to regenerate at state without evaluating kappa
+     *
+     * u_kappa : uniform random variable multiplied by kappa_bar
+     * regen   : set to 1 if the process regenerates, 0 otherwise
+     * Returns 1 if the bounds decided, 0 if kappa must be evaluated.
+     */
+    int squeeze(const arma::vec &state, double u_kappa, int &regen);
+    
+    // Sobol sequence of rebirth points, null unless using RQMC
+    std::unique_ptr<SobolSequence> m_sobol;
+    
+    // Current Sobol point
+    arma::vec m_sobol_u;
+    
+    // Regenerate from the regeneration distribution, returns its cost
+    int rebirth();
+    
+    // tr(cov HessU) at the state of the last evaluation of kappa_partial
+    double m_tr_cov_hess;
+    
+    // Indicator of whether to record control variates, number recorded,
+    // tour in which recording started
+    int m_cv_record, m_cv_n, m_cv_tour0;
+    
+    // Running sums of states, control variates, products of control
+    // variates, and products of control variates and states
+    arma::vec m_cv_sum_x, m_cv_sum_z;
+    arma::mat m_cv_sum_zz, m_cv_sum_zx;
+    
+    // Per-tour sums of states (dimension per tour) and control variates
+    // (dimension + 1 per tour), and number of events per tour
+    std::vector<double> m_cv_tour_x, m_cv_tour_z;
+    std::vector<int> m_cv_tour_n;
+    
+    // Buffer for the control variates at an event
+    arma::vec m_cv_z;
+    
+    // Add the state and control variates at the last evaluation of kappa
+    // to the running sums
+    void record_control_variates(const arma::vec &state);
+    
+    // Simulate the underlying process at time s+t, when its state at
+    // time s is 'state'
+    void diffuse(arma::vec &state, double t);
+    
+    // Draw an exponential with the given rate, a uniform on [0, 1) and a
+    // standard Gaussian, from the prefetched variates if there are any
+    double rexp(double rate);
+    double runif();
+    double rnorm();
     
     /* Simulate the state at the sooner of the next output time or the
      * next potential regeneration time
@@ -0,0 +1,132 @@
+/* Underlying processes for a Restore sampler
+ *
+ * A Diffusion can be simulated exactly over any time interval, and supplies
+ * the part of the regeneration rate determined by the process and target.
+ * Both processes here have constant diffusion matrix cov, so the partial
+ * regeneration rate only needs the target's gradient and tr(cov HessU).
+ */
+#ifndef DIFFUSION_H
+#define DIFFUSION_H
+
+#include "log_post.h"
+#include <armadillo>
+#include <memory>
+
+class Diffusion
+{
+public:
+    // Constructor, with identity diffusion matrix
+    Diffusion(int dimension = 1);
+    
+    virtual ~Diffusion();
+    
+    // Copy of this process
+    virtual std::shared_ptr<Diffusion> clone() const = 0;
+    
+    /* Simulate the state at time s+t, given the state at time s
+     *
+     * state : state at time s, overwritten by the state at time s+t
+     * noise : vector of independent standard Gaussians
+     */
+    virtual void transition(arma::vec &state,
+                            const arma::vec &noise,
+                            double t) const = 0;
+    
+    /* Partial regeneration rate at state
+     *
+     * grad_U        : gradient of the energy at state
+     * tr_cov_hess_U : trace of cov times the Hessian of the energy at state,
+     *                 which is the Laplacian of the energy if isotropic
+     */
+    virtual double kappa_partial(const arma::vec &state,
+                                 const arma::vec &grad_U,
+                                 double tr_cov_hess_U) const = 0;
+    
+    // Set the diffusion matrix. Returns 0 if cov is not positive definite.
+    // The identity matrix makes the process isotropic.
+    int set_covariance(const arma::mat &cov);
+    
+    // Return the diffusion matrix
+    const arma::mat& get_covariance() const;
+    
+    // Return indicator of whether the diffusion matrix is the identity
+    int is_isotropic() const;
+    
+    // Get dimension
+    int get_dimension() const;
+    
+protected:
+    // Dimension, indicator of whether the diffusion matrix is the identity
+    int m_dimension, m_isotropic;
+    
+    // Diffusion matrix and its lower Cholesky factor
+    arma::mat m_cov, m_chol;
+    
+    // Add sd times noise, multiplied by the Cholesky factor unless
+    // isotropic, to state
+    void add_noise(arma::vec &state,
+                   const arma::vec &noise,
+                   double sd) const;
+};
+
+/* Brownian motion with diffusion matrix cov
+ *
+ * Partial regeneration rate 0.5 * (gradU' cov gradU - tr(cov HessU))
+ */
+class BrownianMotion : public Diffusion
+{
+public:
+    BrownianMotion(int dimension = 1);
+    
+    std::shared_ptr<Diffusion> clone() const;
+    
+    void transition(arma::vec &state,
+                    const arma::vec &noise,
+                    double t) const;
+    
+    double kappa_partial(const arma::vec &state,
+                         const arma::vec &grad_U,
+                         double tr_cov_hess_U) const;
+};
+
+/* Ornstein-Uhlenbeck process
+ *      dX = -0.5 (X - mean) dt + cov^(1/2) dW,
+ * whose invariant distribution is Gaussian with the given mean and
+ * covariance matrix. Its partial regeneration rate is
+ *      0.5 * (gradU' cov gradU - tr(cov HessU))
+ *      + 0.5 * (dimension - (x - mean)' gradU),
+ * which is zero when the target is that Gaussian, so centring the process
+ * at a Laplace approximation of the target gives a nearly flat rate.
+ */
+class OrnsteinUhlenbeck : public Diffusion
+{
+public:
+    OrnsteinUhlenbeck(const arma::vec &mean, const arma::mat &cov);
+    
+    std::shared_ptr<Diffusion> clone() const;
+    
+    void transition(arma::vec &state,
+                    const arma::vec &noise,
+                    double t) const;
+    
+    double kappa_partial(const arma::vec &state,
+                         const arma::vec &grad_U,
+                         double tr_cov_hess_U) const;
+    
+private:
+    arma::vec m_mean;
+};
+
+/* Laplace approximation of the posterior by Newton's method
+ *
+ * mode : starting point, overwritten by the mode
+ * cov  : set to the inverse Hessian of the energy at the mode
+ * Returns 1 on convergence, 0 otherwise. The posterior must contain
+ * hess_log_dens.
+ */
+int laplace_approx(LogPost &posterior,
+                   arma::vec &mode,
+                   arma::mat &cov,
+                   int max_iter = 100);
+
+#endif
@@ -5,6 +5,7 @@
 
 #include <armadillo>
 #include <fstream>
+#include <memory>
 
 class LogPost
 {
@@ -37,6 +38,9 @@ public:
     // Sets Data
     void set_data(const arma::mat& data);
     
+    // Sets Data without copying it. Copies of this LogPost share the data.
+    void set_data(std::shared_ptr<const arma::mat> data);
+    
     // Sets the log density
     void set_log_dens(double (*log_dens)(const arma::vec& state,
                                          const arma::mat& data));
@@ -51,6 +55,12 @@ public:
                                 (const arma::vec& state,
                                  const arma::mat& data));
     
+    // Sets the Hessian of the log density. Optional: only needed when the
+    // underlying Brownian motion has a non-identity covariance matrix.
+    void set_hess_log_dens(void (*hess_log_dens)(const arma::vec& state,
+                                                 arma::mat& hess,
+                                                 const arma::mat& data));
+    
     // Get the dimension
     int get_dimension();
     
@@ -80,21 +90,31 @@ public:
     // Laplacian of the energy at state
     double laplacian_U(const arma::vec& state);
     
+    // Update hess, the Hessian of the log density at state
+    void update_hess_log_dens(const arma::vec& state,
+                              arma::mat& hess);
+    
+    // Update hess, the Hessian of the energy at state
+    void update_hess_U(const arma::vec& state,
+                       arma::mat& hess);
+    
     // Return indicator of whether the
-    // log density / grad log density / Laplacian log density
-    // has been constructed.
+    // log density / grad log density / Laplacian log density /
+    // Hessian log density has been constructed.
     int is_log_dens_constructed();
     int is_grad_log_dens_constructed();
     int is_laplacian_log_dens_constructed();
+    int is_hess_log_dens_constructed();
 private:
-    // Data
-    arma::mat m_data;
+    // Data, shared between copies of this object
+    std::shared_ptr<const arma::mat> m_data;
     
     // Dimension, indicators of whether
-    // data/ m_log_dens/m_grad_log_dens/m_laplacian_log_dens
+    // data/ m_log_dens/m_grad_log_dens/m_laplacian_log_dens/m_hess_log_dens
     // has been constructed, indicator of whether to transform the density
     int m_dimension, m_log_dens_constructed, m_data_constructed,
-        m_grad_log_dens_constructed, m_laplacian_log_dens_constructed;
+        m_grad_log_dens_constructed, m_laplacian_log_dens_constructed,
+        m_hess_log_dens_constructed;
     
     // Log density of the posterior
     double (*m_log_dens)(const arma::vec& state,
@@ -108,6 +128,11 @@ private:
     // Laplacian of the log density of the posterior
     double (*m_laplacian_log_dens)(const arma::vec& state,
                                    const arma::mat& data);
+    
+    // Hessian of the log density of the posterior
+    void (*m_hess_log_dens)(const arma::vec& state,
+                            arma::mat& hess,
+                            const arma::mat& data);
 };
 
 #endif
@@ -0,0 +1,35 @@
+/* Functions for Bayesian logistic regression
+ *
+ * The data matrix has one row per observation. Its first column holds the
+ * binary response (0 or 1) and the remaining columns the covariates, so the
+ * dimension of the posterior is the number of columns of data minus one.
+ * The prior on the regression coefficients is standard Gaussian.
+ */
+#ifndef LOGISTIC_H
+#define LOGISTIC_H
+
+#include <armadillo>
+
+/* Log-density (up to an additive constant) of the posterior
+ *
+ * state : regression coefficients
+ * data  : responses and covariates
+ */
+double ld_logistic(const arma::vec &state,
+                   const arma::mat &data);
+
+// Gradient of the log-density, stored in grad
+void grad_ld_logistic(const arma::vec &state,
+                      arma::vec &grad,
+                      const arma::mat &data);
+
+// Laplacian of the log-density
+double lap_ld_logistic(const arma::vec &state,
+                       const arma::mat &data);
+
+// Hessian of the log-density, stored in hess
+void hess_ld_logistic(const arma::vec &state,
+                      arma::mat &hess,
+                      const arma::mat &data);
+
+#endif
@@ -24,4 +24,79 @@ int rmvg_iso(std::mt19937_64 &generator,
              arma::vec &state,
              const arma::mat &data);
 
+/* Simulate a batch from an isotropic multivariate Gaussian
+ *
+ * generator : RNG
+ * states    : one simulated state per column
+ * data      : matrix needed for compatability with RegenDist
+ */
+int rmvg_iso_batch(std::mt19937_64 &generator,
+                   arma::mat &states,
+                   const arma::mat &data);
+
+/* Inverse transform for an isotropic multivariate Gaussian, for use with
+ * quasi-Monte Carlo points
+ *
+ * u     : point in the unit cube, of the same dimension as state
+ * state : simulated state
+ * data  : matrix needed for compatability with RegenDist
+ */
+int qmvg_iso(const arma::vec &u,
+             arma::vec &state,
+             const arma::mat &data);
+
+/* Mixture of isotropic multivariate Gaussians
+ *
+ * data has one column per component: the first row holds the weights,
+ * which sum to one, the next rows the mean and the last row the standard
+ * deviation of the component.
+ */
+
+// Log-density of the mixture
+double ld_mvg_iso_mix(const arma::vec &state,
+                      const arma::mat &data);
+
+// Simulate once from the mixture
+int rmvg_iso_mix(std::mt19937_64 &generator,
+                 arma::vec &state,
+                 const arma::mat &data);
+
+// Simulate a batch from the mixture, one state per column of states.
+// Cumulative weights are computed once per batch.
+int rmvg_iso_mix_batch(std::mt19937_64 &generator,
+                       arma::mat &states,
+                       const arma::mat &data);
+
+// Inverse transform for the mixture. u has one more dimension than state,
+// its first coordinate selects the component.
+int qmvg_iso_mix(const arma::vec &u,
+                 arma::vec &state,
+                 const arma::mat &data);
+
+// Quantile function of the standard Gaussian, for 0 < p < 1
+double qnorm(double p);
+
+/* Log-density (up to an additive constant) of a zero-mean multivariate
+ * Gaussian distribution
+ *
+ * state     : State at which to evaluate the density
+ * precision : precision matrix
+ */
+double ld_mvg_prec(const arma::vec &state,
+                   const arma::mat &precision);
+
+// Gradient of ld_mvg_prec, stored in grad
+void grad_ld_mvg_prec(const arma::vec &state,
+                      arma::vec &grad,
+                      const arma::mat &precision);
+
+// Laplacian of ld_mvg_prec
+double lap_ld_mvg_prec(const arma::vec &state,
+                       const arma::mat &precision);
+
+// Hessian of ld_mvg_prec, stored in hess
+void hess_ld_mvg_prec(const arma::vec &state,
+                      arma::mat &hess,
+                      const arma::mat &precision);
+
 #endif
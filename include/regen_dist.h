@@ -38,10 +38,47 @@ public:
     double U(const arma::vec &state);
     
     // Simulate from the distribution
-    // Stores the generated sample in 'state'
+    // Stores the generated sample in 'state'. If a batch sampler has been
+    // set, the sample is taken from a pool which is refilled when empty.
     int rmu(std::mt19937_64 &generator,
             arma::vec &state);
     
+    /* Set a batch sampler
+     *
+     * rmu_batch  : simulate one sample into each column of 'states', which
+     *              has dimension rows and batch_size columns. Returns an
+     *              integer representing some measure of computing cost.
+     * batch_size : number of samples drawn per call of rmu_batch, at
+     *              least 1. Otherwise the batch sampler isn't set.
+     */
+    void set_rmu_batch(int (*rmu_batch)(std::mt19937_64 &generator,
+                                        arma::mat &states,
+                                        const arma::mat &data),
+                       int batch_size = 256);
+    
+    /* Set an inverse transform, mapping points of the unit cube to samples
+     *
+     * rmu_inverse : store in 'state' the sample corresponding to u. Returns
+     *               an integer representing some measure of computing cost.
+     * u_dimension : dimension of u
+     */
+    void set_rmu_inverse(int (*rmu_inverse)(const arma::vec &u,
+                                            arma::vec &state,
+                                            const arma::mat &data),
+                         int u_dimension);
+    
+    // Map u to a sample, stored in 'state'
+    int rmu_inverse(const arma::vec &u,
+                    arma::vec &state);
+    
+    // Dimension of the points mapped by the inverse transform, 0 if there
+    // is no inverse transform
+    int get_u_dimension();
+    
+    // Discard any unused samples in the pool. Copies of a RegenDist share
+    // the samples left in the pool when copied, so samplers clear it.
+    void clear_pool();
+    
     // Get dimension
     int get_dimension();
     
@@ -63,6 +100,23 @@ private:
     int (*m_rmu)(std::mt19937_64 &generator,
                  arma::vec &state,
                  const arma::mat &data);
+    
+    // Simulate a batch from the distribution, null if not set
+    int (*m_rmu_batch)(std::mt19937_64 &generator,
+                       arma::mat &states,
+                       const arma::mat &data);
+    
+    // Inverse transform, null if not set
+    int (*m_rmu_inverse)(const arma::vec &u,
+                         arma::vec &state,
+                         const arma::mat &data);
+    
+    // Number of samples per batch, index of the next unused sample,
+    // dimension of the points mapped by the inverse transform
+    int m_batch_size, m_pool_next, m_u_dimension;
+    
+    // Pool of samples, one per column
+    arma::mat m_pool;
 };
 
 #endif
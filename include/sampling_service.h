@@ -0,0 +1,179 @@
+/* Long-lived local sampling service
+ *
+ * A SamplingService keeps registered targets (a LogPost and RegenDist,
+ * with their data) resident and serves sampling jobs over a Unix domain
+ * socket. A dispatcher thread polls every connection for requests and
+ * submits each job separately to a shared pool of threads, so idle
+ * connections hold no thread, and jobs from one connection may run
+ * concurrently. Messages are in the native binary layout of the structs
+ * below, since client and server share a machine.
+ *
+ * Per job, the client sends a JobRequest. The server replies with a
+ * JobHeader, carrying the request's id, followed, if the status is
+ * SERVICE_OK, by the requested
+ * outputs in this order: states (a column-major dimension x noutputs
+ * matrix of doubles), times (noutputs doubles) and tour numbers
+ * (noutputs ints). Outputs are written in blocks of SERVICE_BLOCK_SIZE
+ * bytes. Replies on a connection are never interleaved, but when several
+ * jobs are in flight they arrive in order of completion.
+ */
+#ifndef SAMPLING_SERVICE_H
+#define SAMPLING_SERVICE_H
+
+#include "log_post.h"
+#include "regen_dist.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// Bits of JobRequest::output
+#define SERVICE_OUTPUT_STATES 1
+#define SERVICE_OUTPUT_TIMES 2
+#define SERVICE_OUTPUT_TOURS 4
+
+// Values of JobHeader::status
+#define SERVICE_OK 0
+#define SERVICE_UNKNOWN_TARGET 1
+#define SERVICE_BAD_REQUEST 2
+#define SERVICE_FAILED 3
+
+// Largest number of tours, and largest kappa_bar and output rate, accepted
+// in a request
+#define SERVICE_MAX_NTOURS 10000000
+#define SERVICE_MAX_RATE 1e9
+
+#define SERVICE_TARGET_NAME_LENGTH 64
+#define SERVICE_BLOCK_SIZE 65536
+
+// Milliseconds to stop accepting connections after accept fails, e.g.
+// when out of file descriptors
+#define SERVICE_ACCEPT_RETRY_MS 100
+
+struct JobRequest
+{
+    // Name of a registered target, null-terminated
+    char target[SERVICE_TARGET_NAME_LENGTH];
+    uint32_t seed;
+    int32_t ntours;
+    double logC;
+    double kappa_bar;
+    double output_rate;
+    // Which outputs to return, a combination of the SERVICE_OUTPUT_ bits
+    int32_t output;
+    // Chosen by the client and returned in the JobHeader
+    uint64_t id;
+};
+
+struct JobHeader
+{
+    uint64_t id;
+    int32_t status;
+    int32_t dimension;
+    int64_t noutputs;
+    int64_t nevals;
+};
+
+class SamplingService
+{
+public:
+    /* Constructor
+     *
+     * socket_path : path of the Unix domain socket to listen on
+     * nthreads    : number of threads running jobs
+     */
+    SamplingService(std::string socket_path, int nthreads);
+    
+    // Stops the service. Jobs not yet started are dropped.
+    ~SamplingService();
+    
+    // Keep a target resident under the given name.
+    // Should only be called before run.
+    void register_target(std::string name,
+                         LogPost posterior,
+                         RegenDist regen_dist);
+    
+    // Accept connections and dispatch their jobs until stop is called.
+    // Returns 0 if the socket couldn't be opened.
+    int run();
+    
+    // Stop the service: run returns, and open connections are shut down.
+    // May be called from any thread.
+    void stop();
+    
+private:
+    struct Target
+    {
+        LogPost posterior;
+        RegenDist regen_dist;
+    };
+    
+    // A connection, closed once the dispatcher and every job from it have
+    // dropped it
+    struct Client
+    {
+        Client(SamplingService &service, int fd);
+        ~Client();
+        
+        SamplingService &service;
+        int fd;
+        
+        // Bytes read so far of the next request
+        std::size_t nread;
+        JobRequest request;
+        
+        // Serialises replies to this client
+        std::mutex write_mutex;
+    };
+    
+    std::string m_socket_path;
+    int m_listen_fd;
+    
+    // Pipe written by stop to wake the dispatcher
+    int m_wake_fd[2];
+    
+    std::atomic<bool> m_stop;
+    std::map<std::string, Target> m_targets;
+    
+    // File descriptors of open connections, shut down by stop
+    std::set<int> m_client_fds;
+    std::mutex m_client_mutex;
+    
+    // Declared last, so that queued jobs finish before the members they
+    // use are destroyed
+    ThreadPool m_pool;
+    
+    // Read what is available of the next request from client, and submit
+    // it to the pool once complete. Returns 0 on end of file or error.
+    int read_request(std::shared_ptr<Client> client);
+    
+    // Run one job and write its result to the client
+    void run_job(std::shared_ptr<Client> client, const JobRequest &request);
+};
+
+// Read or write exactly n bytes, returns 0 on failure or end of file
+int read_full(int fd, void *buf, std::size_t n);
+int write_full(int fd, const void *buf, std::size_t n);
+
+// Connect to a SamplingService, returns a file descriptor or -1
+int service_connect(std::string socket_path);
+
+/* Submit a job over a connection and read its result
+ *
+ * Requested outputs are stored in states, times and tours.
+ * Returns 0 if the connection failed, else 1 (check header.status).
+ */
+int service_submit(int fd,
+                   const JobRequest &request,
+                   JobHeader &header,
+                   std::vector<double> &states,
+                   std::vector<double> &times,
+                   std::vector<int> &tours);
+
+#endif
@@ -0,0 +1,48 @@
+/* Scrambled Sobol sequence
+ *
+ * Direction numbers are those of Joe and Kuo (new-joe-kuo-6.21201), for up
+ * to SOBOL_MAX_DIMENSION dimensions. Points are randomised by a random
+ * linear matrix scramble and a random digital shift, so each point is
+ * uniformly distributed on the unit cube while the sequence keeps its low
+ * discrepancy. Replicates with different scrambling seeds are independent,
+ * which gives error bars for randomised quasi-Monte Carlo estimates.
+ */
+#ifndef SOBOL_H
+#define SOBOL_H
+
+#include <armadillo>
+#include <cstdint>
+#include <vector>
+
+#define SOBOL_MAX_DIMENSION 21
+#define SOBOL_BITS 32
+
+class SobolSequence
+{
+public:
+    /* Constructor
+     *
+     * dimension     : dimension of the points, at most SOBOL_MAX_DIMENSION
+     * scramble_seed : seed of the random scramble
+     */
+    SobolSequence(int dimension = 1, unsigned int scramble_seed = 0);
+    
+    // Store the next point in u, which must have length dimension
+    void next(arma::vec &u);
+    
+    // Get dimension
+    int get_dimension();
+    
+private:
+    // Dimension, index of the next point
+    int m_dimension;
+    uint64_t m_index;
+    
+    // Scrambled direction numbers, m_direction[j][k] for dimension j
+    std::vector< std::vector<uint32_t> > m_direction;
+    
+    // Current point, as integers
+    std::vector<uint32_t> m_x;
+};
+
+#endif
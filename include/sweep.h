@@ -0,0 +1,109 @@
+/* Parameter sweep over configurations of BMRestore for a single target
+ *
+ * Each configuration is a choice of logC, kappa_bar, regeneration
+ * distribution, output rate and whether to precondition the Brownian
+ * motion. All configurations share the target's data and run concurrently
+ * on one pool of threads, in stages. Preconditioned configurations share
+ * one covariance matrix, estimated by a single pilot run. After each stage,
+ * configurations whose effective sample size per second falls below a
+ * fraction of the best are stopped, so that later stages are spent on the
+ * promising ones.
+ */
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "bmrstr.h"
+#include "diffusion.h"
+#include "log_post.h"
+#include "regen_dist.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class Sweep
+{
+public:
+    /* Constructor
+     *
+     * posterior : target, whose data is shared by every configuration
+     * nthreads  : number of threads running configurations
+     * seed      : seed of the first configuration, incremented for the rest
+     */
+    Sweep(LogPost posterior, int nthreads, unsigned int seed = 0);
+    
+    // Add one configuration. regen_name labels the regeneration
+    // distribution in the table. If precondition is 1, the Brownian motion
+    // has the covariance estimated by the pilot run.
+    void add_config(double logC,
+                    double kappa_bar,
+                    RegenDist regen_dist,
+                    std::string regen_name,
+                    double output_rate,
+                    int precondition = 0);
+    
+    // Add every combination of the given values. regen_name must have one
+    // entry per regeneration distribution.
+    void add_grid(const std::vector<double> &logC,
+                  const std::vector<double> &kappa_bar,
+                  const std::vector<RegenDist> &regen_dist,
+                  const std::vector<std::string> &regen_name,
+                  const std::vector<double> &output_rate,
+                  const std::vector<int> &precondition = {0});
+    
+    /* Set the pilot run, made once at the start of run if any configuration
+     * is preconditioned. Its output covariance is shared by all of them.
+     * The posterior must contain hess_log_dens.
+     */
+    void set_pilot(int pilot_ntours,
+                   double logC,
+                   double kappa_bar,
+                   RegenDist regen_dist);
+    
+    /* Run the sweep
+     *
+     * ntours_per_stage : number of tours added to each running
+     *                    configuration per stage
+     * nstages          : number of stages
+     * keep_fraction    : after each stage, stop configurations whose
+     *                    ESS per second is below keep_fraction times the
+     *                    best. Configurations with bound violations are
+     *                    never the best.
+     */
+    void run(int ntours_per_stage, int nstages, double keep_fraction = 0.5);
+    
+    // Print a table of the configurations and their performance
+    void print_table();
+    
+private:
+    struct Config
+    {
+        double logC, kappa_bar, output_rate;
+        std::string regen_name;
+        int precondition;
+        std::unique_ptr<BMRestore> sampler;
+        
+        // CPU time in seconds, smallest ESS over components, ESS per
+        // second, stage after which it was stopped (-1 if never, -2 if
+        // dropped because the pilot run failed)
+        double secs, min_ess, ess_per_sec;
+        int stopped;
+    };
+    
+    LogPost m_posterior;
+    int m_nthreads;
+    unsigned int m_seed;
+    std::vector<Config> m_configs;
+    
+    // Sampler of the pilot run, null if none is set, and its CPU time
+    std::unique_ptr<BMRestore> m_pilot;
+    double m_pilot_secs;
+    
+    // Run the pilot and give its covariance to preconditioned
+    // configurations. Returns 0 on failure.
+    int run_pilot();
+    
+    // Simulate the next stage of a configuration
+    void run_stage(Config &config, int ntours);
+};
+
+#endif
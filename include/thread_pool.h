@@ -0,0 +1,39 @@
+/* Fixed-size pool of threads running queued tasks in order of submission
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    ThreadPool(int nthreads);
+    
+    // Waits for queued tasks to finish
+    ~ThreadPool();
+    
+    void submit(std::function<void()> task);
+    
+    // Wait until every submitted task has finished
+    void wait();
+    
+private:
+    std::vector<std::thread> m_workers;
+    std::queue< std::function<void()> > m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv, m_cv_done;
+    bool m_stop;
+    
+    // Number of tasks queued or running
+    int m_pending;
+    
+    void work();
+};
+
+#endif
@@ -0,0 +1,108 @@
+/* Streams of pre-generated random variates
+ *
+ * Standard exponential, uniform and standard Gaussian variates are each
+ * drawn from their own generator, seeded from a single seed, and stored in
+ * single-producer/single-consumer ring buffers. Buffers are refilled either
+ * in blocks by the consumer, or by a producer thread, which sleeps until a
+ * buffer drops below half its capacity. Either way, the sequence of each
+ * kind of variate depends only on the seed.
+ */
+#ifndef VARIATE_STREAM_H
+#define VARIATE_STREAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Ways of refilling the buffers
+#define VARIATE_BATCH 1
+#define VARIATE_THREAD 2
+
+// Lock-free ring buffer with one producer and one consumer
+class VariateRing
+{
+public:
+    // capacity is rounded up to a power of two
+    VariateRing(unsigned int seed, std::size_t capacity);
+    
+    // Pop a variate. Precondition: the ring is not empty.
+    double pop();
+    
+    // Number of variates available to the consumer
+    std::size_t size();
+    
+    // Number of variates the ring can hold
+    std::size_t capacity();
+    
+    // Fill all free space with variates of the given kind
+    // (0: exponential, 1: uniform, 2: Gaussian), returns number generated
+    std::size_t fill(int kind);
+    
+private:
+    std::vector<double> m_buf;
+    std::size_t m_mask;
+    std::mt19937_64 m_gen;
+    std::normal_distribution<double> m_rnorm;
+    
+    // Index of the next variate to pop, and of the next free slot
+    alignas(64) std::atomic<std::size_t> m_head;
+    alignas(64) std::atomic<std::size_t> m_tail;
+};
+
+class VariateStream
+{
+public:
+    /* Constructor
+     *
+     * seed     : seed from which the generator of each kind is seeded
+     * mode     : VARIATE_BATCH or VARIATE_THREAD
+     * capacity : number of variates buffered of each kind, raised to 2
+     *            if smaller
+     */
+    VariateStream(unsigned int seed, int mode, std::size_t capacity = 4096);
+    
+    // Stops the producer thread, if any
+    ~VariateStream();
+    
+    // Standard exponential variate
+    double exponential();
+    
+    // Uniform variate on [0, 1)
+    double uniform();
+    
+    // Standard Gaussian variate
+    double normal();
+    
+private:
+    int m_mode;
+    
+    // Rings of exponential, uniform and Gaussian variates
+    VariateRing m_exp, m_unif, m_norm;
+    
+    // Producer thread and flag telling it to stop
+    std::thread m_producer;
+    std::atomic<bool> m_stop;
+    
+    // Mutex and condition variables on which the producer sleeps while the
+    // rings are above half capacity, and the consumer while a ring is empty,
+    // and flags telling the other side that a thread is asleep
+    std::mutex m_mutex;
+    std::condition_variable m_wake_producer, m_wake_consumer;
+    std::atomic<bool> m_producer_waiting, m_consumer_waiting;
+    
+    // Pop a variate, refilling or waiting for an empty ring of the given
+    // kind, and waking the producer when the ring runs low
+    double pop(VariateRing &ring, int kind);
+    
+    // Return whether any ring is below half its capacity
+    bool low();
+    
+    // Loop run by the producer thread
+    void produce();
+};
+
+#endif
@@ -1,13 +1,19 @@
 /* Brownian Motion Restore simulation in multiple dimensions
  */
 #include "bmrstr.h"
+#include "diffusion.h"
 #include "log_post.h"
 #include "regen_dist.h"
+#include "sobol.h"
+#include "variate_stream.h"
+#include <algorithm>
 #include <armadillo>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <string>
 #include <vector>
@@ -31,6 +37,7 @@ BMRestore::BMRestore(LogPost posterior,
     }
     
     m_regen_dist = regen_dist;
+    m_regen_dist.clear_pool();
     m_logC = logC;
     m_kappa_bar = kappa_bar;
     m_log_kappa_bar = log(kappa_bar);
@@ -41,11 +48,34 @@ BMRestore::BMRestore(LogPost posterior,
     m_tour_current = 0;
     m_nevals = 0;
     m_x_current.set_size(m_dimension);
+    m_diffusion = std::make_shared<BrownianMotion>(m_dimension);
+    m_grad.set_size(m_dimension);
+    m_noise.set_size(m_dimension);
+    m_npotential = 0;
+    m_nsqueezed = 0;
+    m_nviolations = 0;
+    m_kappa_ref_valid = 0;
+    m_kappa_lipschitz = 0;
+    m_kappa_bounds = nullptr;
+    m_seed = std::mt19937_64::default_seed;
+    m_prefetch_mode = 0;
+    m_cv_record = 0;
+    m_cv_n = 0;
+    m_cv_tour0 = 0;
+    m_single_output = 0;
+    update_total_rate();
 }
 
 void BMRestore::set_regen_dist(RegenDist regen_dist)
 {
     m_regen_dist = regen_dist;
+    m_regen_dist.clear_pool();
+    if (m_sobol &&
+        m_regen_dist.get_u_dimension() != m_sobol->get_dimension()){
+        std::cerr << "RegenDist is incompatible with RQMC, "
+                  << "drawing rebirth states independently\n";
+        m_sobol.reset();
+    }
 }
 
 void BMRestore::set_logC(const double logC)
@@ -57,6 +87,7 @@ void BMRestore::set_kappa_bar(const double kappa_bar)
 {
     m_kappa_bar = kappa_bar;
     m_log_kappa_bar = log(kappa_bar);
+    update_total_rate();
 }
 
 void BMRestore::set_ntours(const int ntours)
@@ -67,20 +98,141 @@ void BMRestore::set_ntours(const int ntours)
 void BMRestore::set_output_rate(const double output_rate)
 {
     m_output_rate = output_rate;
+    update_total_rate();
 }
 
 void BMRestore::set_seed(const unsigned int s)
 {
     m_gen.seed(s);
+    m_seed = s;
+    if (m_prefetch_mode){
+        set_prefetch(m_prefetch_mode, m_prefetch_capacity);
+    }
+}
+
+void BMRestore::set_prefetch(const int mode, const int capacity)
+{
+    if (mode && capacity < 2){
+        std::cerr << "Prefetch capacity must be at least 2\n";
+        return;
+    }
+    m_prefetch_mode = mode;
+    m_prefetch_capacity = capacity;
+    if (mode == VARIATE_BATCH || mode == VARIATE_THREAD){
+        m_variates.reset(new VariateStream(m_seed, mode, capacity));
+    } else {
+        m_variates.reset();
+    }
+}
+
+void BMRestore::set_rqmc(const int rqmc, const unsigned int scramble_seed)
+{
+    if (!rqmc){
+        m_sobol.reset();
+        return;
+    }
+    int u_dimension = m_regen_dist.get_u_dimension();
+    if (u_dimension == 0){
+        std::cerr << "RegenDist doesn't contain rmu_inverse\n";
+        return;
+    }
+    if (u_dimension > SOBOL_MAX_DIMENSION){
+        std::cerr << "RegenDist needs more than " << SOBOL_MAX_DIMENSION
+                  << " uniforms per sample for RQMC\n";
+        return;
+    }
+    m_sobol.reset(new SobolSequence(u_dimension, scramble_seed));
+    m_sobol_u.set_size(u_dimension);
+}
+
+int BMRestore::rebirth()
+{
+    if (m_sobol){
+        m_sobol->next(m_sobol_u);
+        return m_regen_dist.rmu_inverse(m_sobol_u, m_x_current);
+    }
+    return m_regen_dist.rmu(m_gen, m_x_current);
+}
+
+void BMRestore::set_diffusion(std::shared_ptr<Diffusion> diffusion)
+{
+    if (diffusion->get_dimension() != m_dimension){
+        std::cerr << "Diffusion has the wrong dimension\n";
+        return;
+    }
+    if (!diffusion->is_isotropic() &&
+        !m_posterior.is_hess_log_dens_constructed()){
+        std::cerr << "LogPost doesn't contain hess_log_dens, "
+                  << "keeping the current process\n";
+        return;
+    }
+    m_diffusion = diffusion;
+    
+    // The Hessian is only needed for a non-isotropic process
+    if (m_diffusion->is_isotropic()){
+        m_hess.reset();
+    } else {
+        m_hess.set_size(m_dimension, m_dimension);
+    }
+}
+
+void BMRestore::set_covariance(const arma::mat &cov)
+{
+    // The process may be shared with other samplers
+    std::shared_ptr<Diffusion> diffusion = m_diffusion->clone();
+    if (diffusion->set_covariance(cov)){
+        set_diffusion(diffusion);
+    }
+}
+
+void BMRestore::estimate_covariance(const int pilot_ntours)
+{
+    int ntours = m_ntours;
+    m_ntours = pilot_ntours;
+    gen_fixed_ntours();
+    m_ntours = ntours;
+    
+    int n = get_noutputs();
+    if (n < 2){
+        std::cerr << "Too few output states to estimate covariance\n";
+    } else if (!m_single_output){
+        arma::mat x(m_x.data(), m_dimension, n, false, true);
+        set_covariance(arma::cov(x.t()));
+    } else {
+        // Read states stored as floats back in double precision
+        arma::mat x(m_dimension, n);
+        arma::vec xi(m_dimension);
+        for (int i = 0; i < n; i++){
+            output_state(i, xi);
+            x.col(i) = xi;
+        }
+        set_covariance(arma::cov(x.t()));
+    }
+    
+    // Discard the pilot run
+    m_x.clear();
+    m_x_single.clear();
+    m_t.clear();
+    m_tour_number.clear();
+    m_t_current = 0;
+    m_tour_current = 0;
+    if (m_cv_record){
+        set_control_variates(1);
+    }
 }
 
 double BMRestore::kappa_partial(const arma::vec &state)
 {
-    // Compute the gradient
-    arma::vec grad(m_dimension);
-    m_posterior.update_grad_U(state, grad);
+    // Compute the gradient and tr(cov * Hessian)
+    m_posterior.update_grad_U(state, m_grad);
+    if (m_diffusion->is_isotropic()){
+        m_tr_cov_hess = m_posterior.laplacian_U(state);
+    } else {
+        m_posterior.update_hess_U(state, m_hess);
+        m_tr_cov_hess = arma::accu(m_diffusion->get_covariance() % m_hess);
+    }
     
-    return 0.5 * (arma::dot(grad, grad) - m_posterior.laplacian_U(state));
+    return m_diffusion->kappa_partial(state, m_grad, m_tr_cov_hess);
 }
 
 double BMRestore::kappa(const arma::vec &state)
@@ -90,11 +242,256 @@ double BMRestore::kappa(const arma::vec &state)
                - m_posterior.log_dens(state));
 }
 
+double BMRestore::log_kappa(const arma::vec &state)
+{
+    double kp = kappa_partial(state);
+    double a = m_logC + m_regen_dist.log_dens(state)
+               - m_posterior.log_dens(state);
+    
+    if (kp > 0){
+        // log(exp(log(kp)) + exp(a))
+        double log_kp = log(kp);
+        if (log_kp > a){
+            return log_kp + log1p(exp(a - log_kp));
+        }
+        return a + log1p(exp(log_kp - a));
+    } else if (kp == 0){
+        return a;
+    }
+    // kappa = exp(a) * (1 + kp * exp(-a))
+    double r = kp * exp(-a);
+    if (r <= -1){
+        return -INFINITY;
+    }
+    return a + log1p(r);
+}
+
+void BMRestore::set_kappa_bounds(void (*kappa_bounds)(const arma::vec &state,
+                                                      double &lower,
+                                                      double &upper,
+                                                      const arma::mat &data),
+                                 const arma::mat &data)
+{
+    m_kappa_bounds = kappa_bounds;
+    m_kappa_bounds_data = data;
+}
+
+int BMRestore::add_poisson_observer(const double rate, Observer observer,
+                                    void *data)
+{
+    if (rate <= 0){
+        std::cerr << "Observer rate must be positive\n";
+        return -1;
+    }
+    m_observers.push_back(observer);
+    m_observer_data.push_back(data);
+    m_observer_rates.push_back(rate);
+    m_poisson_observers.push_back(m_observers.size() - 1);
+    update_total_rate();
+    return m_observers.size() - 1;
+}
+
+int BMRestore::add_timed_observer(const double t, const double period,
+                                  Observer observer, void *data)
+{
+    if (period < 0){
+        std::cerr << "Observer period must be non-negative\n";
+        return -1;
+    }
+    m_observers.push_back(observer);
+    m_observer_data.push_back(data);
+    m_observer_rates.push_back(period);
+    m_timed_events.push(std::make_pair(t, (int) m_observers.size() - 1));
+    return m_observers.size() - 1;
+}
+
+void BMRestore::update_total_rate()
+{
+    m_total_rate = m_kappa_bar + m_output_rate;
+    for (int k : m_poisson_observers){
+        m_total_rate += m_observer_rates[k];
+    }
+}
+
+void BMRestore::run_timed_events(double t)
+{
+    while (!m_timed_events.empty() && m_timed_events.top().first < t){
+        double t_event = m_timed_events.top().first;
+        int k = m_timed_events.top().second;
+        m_timed_events.pop();
+        
+        if (t_event > m_t_current){
+            diffuse(m_x_current, t_event - m_t_current);
+            m_t_current = t_event;
+        }
+        m_observers[k](m_x_current, m_t_current, m_tour_current,
+                       m_observer_data[k]);
+        if (m_observer_rates[k] > 0){
+            m_timed_events.push(std::make_pair(t_event + m_observer_rates[k],
+                                               k));
+        }
+    }
+}
+
+void BMRestore::run_poisson_observer(double v)
+{
+    // Observers are few, so a linear search is cheapest. The last
+    // observer takes v rounding up to the sum of their rates.
+    int k = m_poisson_observers.back();
+    for (int j : m_poisson_observers){
+        if (v < m_observer_rates[j]){
+            k = j;
+            break;
+        }
+        v -= m_observer_rates[j];
+    }
+    m_observers[k](m_x_current, m_t_current, m_tour_current,
+                   m_observer_data[k]);
+}
+
+void BMRestore::set_kappa_lipschitz(const double lipschitz)
+{
+    m_kappa_lipschitz = lipschitz;
+}
+
+int BMRestore::squeeze(const arma::vec &state, double u_kappa, int &regen)
+{
+    double lower = -INFINITY;
+    double upper = INFINITY;
+    double l, u;
+    
+    if (m_kappa_bounds != nullptr){
+        m_kappa_bounds(state, l, u, m_kappa_bounds_data);
+        lower = std::max(lower, l);
+        upper = std::min(upper, u);
+    }
+    if (m_kappa_lipschitz > 0 && m_kappa_ref_valid){
+        double r = m_kappa_lipschitz * arma::norm(state - m_x_ref);
+        lower = std::max(lower, m_kappa_ref - r);
+        upper = std::min(upper, m_kappa_ref + r);
+    }
+    
+    if (u_kappa < lower){
+        regen = 1;
+        return 1;
+    } else if (u_kappa >= upper){
+        regen = 0;
+        return 1;
+    }
+    return 0;
+}
+
+void BMRestore::set_control_variates(const int record)
+{
+    m_cv_record = record;
+    m_cv_n = 0;
+    m_cv_tour0 = m_tour_current;
+    m_cv_sum_x.zeros(m_dimension);
+    m_cv_sum_z.zeros(m_dimension + 1);
+    m_cv_sum_zz.zeros(m_dimension + 1, m_dimension + 1);
+    m_cv_sum_zx.zeros(m_dimension + 1, m_dimension);
+    m_cv_z.set_size(m_dimension + 1);
+    m_cv_tour_x.clear();
+    m_cv_tour_z.clear();
+    m_cv_tour_n.clear();
+}
+
+void BMRestore::record_control_variates(const arma::vec &state)
+{
+    // Gradient of the energy, and twice the Brownian motion part of kappa
+    for (int j = 0; j < m_dimension; j++){
+        m_cv_z(j) = m_grad(j);
+    }
+    if (m_diffusion->is_isotropic()){
+        m_cv_z(m_dimension) = arma::dot(m_grad, m_grad) - m_tr_cov_hess;
+    } else {
+        m_cv_z(m_dimension) = arma::dot(m_grad,
+                                        m_diffusion->get_covariance() * m_grad)
+                              - m_tr_cov_hess;
+    }
+    
+    m_cv_n++;
+    m_cv_sum_x += state;
+    m_cv_sum_z += m_cv_z;
+    m_cv_sum_zz += m_cv_z * m_cv_z.t();
+    m_cv_sum_zx += m_cv_z * state.t();
+    
+    // Per-tour sums, for the regenerative variance of the estimates
+    std::size_t k = m_tour_current - m_cv_tour0;
+    if (m_cv_tour_n.size() <= k){
+        m_cv_tour_n.resize(k + 1, 0);
+        m_cv_tour_x.resize((k + 1) * m_dimension, 0.0);
+        m_cv_tour_z.resize((k + 1) * (m_dimension + 1), 0.0);
+    }
+    m_cv_tour_n[k]++;
+    for (int j = 0; j < m_dimension; j++){
+        m_cv_tour_x[k * m_dimension + j] += state(j);
+    }
+    for (int j = 0; j <= m_dimension; j++){
+        m_cv_tour_z[k * (m_dimension + 1) + j] += m_cv_z(j);
+    }
+}
+
+void BMRestore::zv_mean(arma::vec &mean,
+                        arma::vec &plain_mean,
+                        arma::vec &var_ratio)
+{
+    if (m_cv_n < m_dimension + 2){
+        std::cerr << "Too few recorded events to fit control variates\n";
+        return;
+    }
+    plain_mean = m_cv_sum_x / m_cv_n;
+    arma::vec z_mean = m_cv_sum_z / m_cv_n;
+    arma::mat cov_zz = m_cv_sum_zz / m_cv_n - z_mean * z_mean.t();
+    arma::mat cov_zx = m_cv_sum_zx / m_cv_n - z_mean * plain_mean.t();
+    
+    // Coefficients minimising the variance of x - coef' z
+    arma::mat coef;
+    if (!arma::solve(coef, cov_zz, cov_zx)){
+        std::cerr << "Control variates are degenerate\n";
+        return;
+    }
+    mean = plain_mean - coef.t() * z_mean;
+    
+    // Events within a tour are correlated but tours are independent, so
+    // the variance of each estimator is estimated from the per-tour sums,
+    // as in ess. Only completed tours are used, and trailing tours with
+    // no recorded events contribute zero sums.
+    int ntours = m_tour_current - m_cv_tour0;
+    if ((int) m_cv_tour_n.size() < ntours){
+        m_cv_tour_n.resize(ntours, 0);
+        m_cv_tour_x.resize(ntours * m_dimension, 0.0);
+        m_cv_tour_z.resize(ntours * (m_dimension + 1), 0.0);
+    }
+    var_ratio.set_size(m_dimension);
+    var_ratio.fill(NAN);
+    if (ntours < 2){
+        std::cerr << "Too few tours to estimate the variance ratio\n";
+        return;
+    }
+    arma::vec sigma2_x(m_dimension, arma::fill::zeros);
+    arma::vec sigma2_cv(m_dimension, arma::fill::zeros);
+    arma::vec tour_x(m_dimension), tour_z(m_dimension + 1), resid(m_dimension);
+    for (int k = 0; k < ntours; k++){
+        for (int j = 0; j < m_dimension; j++){
+            tour_x(j) = m_cv_tour_x[k * m_dimension + j];
+        }
+        for (int j = 0; j <= m_dimension; j++){
+            tour_z(j) = m_cv_tour_z[k * (m_dimension + 1) + j];
+        }
+        resid = tour_x - m_cv_tour_n[k] * plain_mean;
+        sigma2_x += resid % resid;
+        resid = tour_x - coef.t() * tour_z - m_cv_tour_n[k] * mean;
+        sigma2_cv += resid % resid;
+    }
+    var_ratio = sigma2_cv / sigma2_x;
+}
+
 void BMRestore::gen_fixed_ntours()
 {
     // Regenerate and track number of target evaluations.
     // .rmu should return the sum of the number of evaluations of U, gradU, LapU.
-    m_nevals += m_regen_dist.rmu(m_gen, m_x_current);
+    m_nevals += rebirth();
     
     while (m_tour_current < m_ntours)
     {
@@ -132,11 +529,11 @@ void BMRestore::print_output_times(std::ofstream &file,
 
 void BMRestore::print_output_states()
 {
-    std::vector<arma::vec>::iterator row;
-    arma::vec::iterator col;
-    for (row = m_x.begin(); row != m_x.end(); ++row){
-        for (col = (*row).begin(); col != (*row).end(); ++col){
-            std::cout << *col << ' ';
+    arma::vec x(m_dimension);
+    for (int i = 0; i < get_noutputs(); i++){
+        output_state(i, x);
+        for (int j = 0; j < m_dimension; j++){
+            std::cout << x(j) << ' ';
         }
         std::cout << '\n';
     }
@@ -149,11 +546,11 @@ void BMRestore::print_output_states(std::ofstream &file,
         std::cerr << "file should be closed\n";
     } else {
         file.open(file_name);
-        std::vector<arma::vec>::iterator row;
-        arma::vec::iterator col;
-        for (row = m_x.begin(); row != m_x.end(); ++row){
-            for (col = (*row).begin(); col != (*row).end(); ++col){
-                file << *col << ' ';
+        arma::vec x(m_dimension);
+        for (int i = 0; i < get_noutputs(); i++){
+            output_state(i, x);
+            for (int j = 0; j < m_dimension; j++){
+                file << x(j) << ' ';
             }
             file << '\n';
         }
@@ -161,6 +558,60 @@ void BMRestore::print_output_states(std::ofstream &file,
     }
 }
 
+void BMRestore::set_output_precision(const int single)
+{
+    if (get_noutputs() > 0){
+        std::cerr << "Output precision must be set before simulating\n";
+        return;
+    }
+    m_single_output = single;
+}
+
+int BMRestore::is_output_single()
+{
+    return m_single_output;
+}
+
+int BMRestore::get_noutputs()
+{
+    return m_t.size();
+}
+
+const double* BMRestore::get_output_states_data()
+{
+    return m_single_output ? nullptr : m_x.data();
+}
+
+const float* BMRestore::get_output_states_data_single()
+{
+    return m_single_output ? m_x_single.data() : nullptr;
+}
+
+void BMRestore::output_state(int i, arma::vec &x)
+{
+    if (m_single_output){
+        const float *xi = m_x_single.data() + (std::size_t) i * m_dimension;
+        for (int j = 0; j < m_dimension; j++){
+            x(j) = xi[j];
+        }
+    } else {
+        const double *xi = m_x.data() + (std::size_t) i * m_dimension;
+        for (int j = 0; j < m_dimension; j++){
+            x(j) = xi[j];
+        }
+    }
+}
+
+const double* BMRestore::get_output_times_data()
+{
+    return m_t.data();
+}
+
+const int* BMRestore::get_output_tour_number_data()
+{
+    return m_tour_number.data();
+}
+
 int BMRestore::get_nevals()
 {
     return m_nevals;
@@ -199,54 +650,171 @@ double BMRestore::get_kappa_bar()
     return m_kappa_bar;
 }
 
-void BMRestore::bm(std::mt19937_64 &generator, arma::vec &state, double t)
+int BMRestore::get_ntours_completed()
+{
+    return m_tour_current;
+}
+
+int BMRestore::get_npotential_regen()
+{
+    return m_npotential;
+}
+
+int BMRestore::get_nsqueezed()
+{
+    return m_nsqueezed;
+}
+
+int BMRestore::get_nviolations()
+{
+    return m_nviolations;
+}
+
+void BMRestore::ess(arma::vec &ess)
+{
+    int ntours = m_tour_current;
+    int n = get_noutputs();
+    ess.zeros(m_dimension);
+    if (ntours < 2 || n < 2){
+        std::cerr << "Too few tours to estimate the effective sample size\n";
+        return;
+    }
+    
+    // Per-tour sums of output states and number of outputs per tour
+    arma::mat tour_sum(m_dimension, ntours, arma::fill::zeros);
+    arma::vec tour_n(ntours, arma::fill::zeros);
+    arma::vec mean(m_dimension, arma::fill::zeros);
+    arma::vec sq(m_dimension, arma::fill::zeros);
+    arma::vec x(m_dimension);
+    for (int i = 0; i < n; i++){
+        output_state(i, x);
+        if (m_tour_number[i] < ntours){
+            tour_sum.col(m_tour_number[i]) += x;
+            tour_n(m_tour_number[i]) += 1;
+        }
+        mean += x;
+        sq += x % x;
+    }
+    mean /= n;
+    arma::vec var = sq / n - mean % mean;
+    
+    double n_bar = arma::accu(tour_n) / ntours;
+    arma::vec sigma2(m_dimension, arma::fill::zeros);
+    arma::vec resid(m_dimension);
+    for (int k = 0; k < ntours; k++){
+        resid = tour_sum.col(k) - tour_n(k) * mean;
+        sigma2 += resid % resid;
+    }
+    sigma2 /= ntours * n_bar * n_bar;
+    
+    ess = ntours * var / sigma2;
+}
+
+void BMRestore::diffuse(arma::vec &state, double t)
 {
-    std::normal_distribution<double> normal(0.0, 1.0);
-    double n;
-    for (arma::vec::iterator x = state.begin(); x != state.end(); ++x)
+    for (arma::vec::iterator z = m_noise.begin(); z != m_noise.end(); ++z)
     {
-        n = normal(generator);
-        (*x) += sqrt(t) * n;
+        *z = rnorm();
     }
+    m_diffusion->transition(state, m_noise, t);
+}
+
+double BMRestore::rexp(double rate)
+{
+    if (m_variates){
+        return m_variates->exponential() / rate;
+    }
+    std::exponential_distribution<double> exp_rate(rate);
+    return exp_rate(m_gen);
+}
+
+double BMRestore::runif()
+{
+    if (m_variates){
+        return m_variates->uniform();
+    }
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    return unif(m_gen);
+}
+
+double BMRestore::rnorm()
+{
+    if (m_variates){
+        return m_variates->normal();
+    }
+    return m_rnorm(m_gen);
 }
 
 void BMRestore::next_state()
 {
-    // RNGs: uniform, dominating PP, exogeneous output PP
-    std::uniform_real_distribution<double> runif(0.0, 1.0);
-    std::exponential_distribution<double> exp_kappa_bar(m_kappa_bar);
-    std::exponential_distribution<double> exp_output(m_output_rate);
+    // Potential regeneration, output and Poisson observer events are the
+    // superposition of their Poisson processes: simulate the time to the
+    // next event at the total rate, then choose which clock rang with
+    // probability proportional to its rate.
+    double dt = rexp(m_total_rate);
     
-    // Simulate whether a potential regeneration event occurs
-    // before the next output event
-    double t_next_potential_regen = exp_kappa_bar(m_gen);
-    double t_next_output = exp_output(m_gen);
+    // Timed observer events don't change the rates, so the next Poisson
+    // event time stands and the process is simulated up to each of them
+    if (!m_timed_events.empty()){
+        double t_next = m_t_current + dt;
+        run_timed_events(t_next);
+        dt = t_next - m_t_current;
+    }
     
-    if (t_next_potential_regen < t_next_output){
-        // Simulate state at next potential regeneration time
-        m_t_current += t_next_potential_regen;
-        bm(m_gen, m_x_current, t_next_potential_regen);
-        
-        // Simulate whether regeneration occurs
-        double u = runif(m_gen);
-        double kx, log_kx;
+    m_t_current += dt;
+    diffuse(m_x_current, dt);
+    double v = runif() * m_total_rate;
+    
+    if (v < m_kappa_bar){
+        // Simulate whether regeneration occurs at this potential
+        // regeneration event. Given the choice of clock, v / kappa_bar is
+        // uniform, so it is reused rather than drawing another uniform. Try
+        // the bounds on kappa first, and only evaluate kappa if they don't
+        // decide.
+        double u = v / m_kappa_bar;
+        int regen;
+        m_npotential++;
         
-        kx = kappa(m_x_current);
-        log_kx = log(kx);
-        m_nevals += 3; // evaluate U, gradU, lapU
+        if (!m_cv_record && squeeze(m_x_current, u * m_kappa_bar, regen)){
+            m_nsqueezed++;
+        } else {
+            double log_kx = log_kappa(m_x_current);
+            m_nevals += 3; // evaluate U, gradU, lapU
+            regen = log(u) < (log_kx - m_log_kappa_bar);
+            if (log_kx > m_log_kappa_bar){
+                m_nviolations++;
+            }
+            
+            if (m_cv_record){
+                record_control_variates(m_x_current);
+            }
+            
+            if (m_kappa_lipschitz > 0){
+                m_x_ref = m_x_current;
+                m_kappa_ref = exp(log_kx);
+                m_kappa_ref_valid = 1;
+            }
+        }
         
-        if (log(u) < (log_kx - m_log_kappa_bar)){
-            m_nevals += m_regen_dist.rmu(m_gen, m_x_current);
+        if (regen){
+            m_nevals += rebirth();
             m_tour_current++;
+            m_kappa_ref_valid = 0;
+        }
+    } else if (v < m_kappa_bar + m_output_rate ||
+               m_poisson_observers.empty()){
+        // Record current state, time and tour number. Without Poisson
+        // observers this is the last clock, so it also takes v rounding
+        // up to the total rate.
+        if (m_single_output){
+            m_x_single.insert(m_x_single.end(), m_x_current.begin(),
+                              m_x_current.end());
+        } else {
+            m_x.insert(m_x.end(), m_x_current.begin(), m_x_current.end());
         }
-    } else {
-        // Simulate the state at the next output time
-        // and record current state, time and tour number
-        m_t_current += t_next_output;
-        bm(m_gen, m_x_current, t_next_output);
-        
-        m_x.push_back(m_x_current);
         m_tour_number.push_back(m_tour_current);
         m_t.push_back(m_t_current);
+    } else {
+        run_poisson_observer(v - m_kappa_bar - m_output_rate);
     }
 }
@@ -0,0 +1,166 @@
+/* Underlying processes for a Restore sampler
+ */
+#include "diffusion.h"
+#include "log_post.h"
+#include <armadillo>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+Diffusion::Diffusion(int dimension)
+{
+    m_dimension = dimension;
+    m_isotropic = 1;
+}
+
+Diffusion::~Diffusion()
+{
+}
+
+int Diffusion::set_covariance(const arma::mat &cov)
+{
+    if ((int) cov.n_rows != m_dimension || (int) cov.n_cols != m_dimension){
+        std::cerr << "Covariance matrix has the wrong dimensions\n";
+        return 0;
+    }
+    
+    // The identity keeps the cheaper isotropic path, which needs no Hessian
+    int identity = 1;
+    for (int i = 0; i < m_dimension && identity; i++){
+        for (int j = 0; j < m_dimension; j++){
+            if (cov(i, j) != (i == j ? 1.0 : 0.0)){
+                identity = 0;
+                break;
+            }
+        }
+    }
+    if (identity){
+        m_cov = cov;
+        m_chol.reset();
+        m_isotropic = 1;
+        return 1;
+    }
+    
+    if (!arma::chol(m_chol, cov, "lower")){
+        std::cerr << "Covariance matrix is not positive definite\n";
+        return 0;
+    }
+    m_cov = cov;
+    m_isotropic = 0;
+    return 1;
+}
+
+const arma::mat& Diffusion::get_covariance() const
+{
+    return m_cov;
+}
+
+int Diffusion::is_isotropic() const
+{
+    return m_isotropic;
+}
+
+int Diffusion::get_dimension() const
+{
+    return m_dimension;
+}
+
+void Diffusion::add_noise(arma::vec &state,
+                          const arma::vec &noise,
+                          double sd) const
+{
+    if (m_isotropic){
+        state += sd * noise;
+    } else {
+        state += sd * (m_chol * noise);
+    }
+}
+
+BrownianMotion::BrownianMotion(int dimension) : Diffusion(dimension)
+{
+}
+
+std::shared_ptr<Diffusion> BrownianMotion::clone() const
+{
+    return std::make_shared<BrownianMotion>(*this);
+}
+
+void BrownianMotion::transition(arma::vec &state,
+                                const arma::vec &noise,
+                                double t) const
+{
+    add_noise(state, noise, sqrt(t));
+}
+
+double BrownianMotion::kappa_partial(const arma::vec &state,
+                                     const arma::vec &grad_U,
+                                     double tr_cov_hess_U) const
+{
+    if (m_isotropic){
+        return 0.5 * (arma::dot(grad_U, grad_U) - tr_cov_hess_U);
+    }
+    return 0.5 * (arma::dot(grad_U, m_cov * grad_U) - tr_cov_hess_U);
+}
+
+OrnsteinUhlenbeck::OrnsteinUhlenbeck(const arma::vec &mean,
+                                     const arma::mat &cov)
+    : Diffusion(mean.n_elem)
+{
+    m_mean = mean;
+    set_covariance(cov);
+}
+
+std::shared_ptr<Diffusion> OrnsteinUhlenbeck::clone() const
+{
+    return std::make_shared<OrnsteinUhlenbeck>(*this);
+}
+
+void OrnsteinUhlenbeck::transition(arma::vec &state,
+                                   const arma::vec &noise,
+                                   double t) const
+{
+    double decay = exp(-0.5 * t);
+    double sd = sqrt(-expm1(-t));
+    state = m_mean + decay * (state - m_mean);
+    add_noise(state, noise, sd);
+}
+
+double OrnsteinUhlenbeck::kappa_partial(const arma::vec &state,
+                                        const arma::vec &grad_U,
+                                        double tr_cov_hess_U) const
+{
+    double bm_part;
+    if (m_isotropic){
+        bm_part = arma::dot(grad_U, grad_U) - tr_cov_hess_U;
+    } else {
+        bm_part = arma::dot(grad_U, m_cov * grad_U) - tr_cov_hess_U;
+    }
+    return 0.5 * (bm_part + m_dimension - arma::dot(state - m_mean, grad_U));
+}
+
+int laplace_approx(LogPost &posterior,
+                   arma::vec &mode,
+                   arma::mat &cov,
+                   int max_iter)
+{
+    int d = posterior.get_dimension();
+    arma::vec grad(d);
+    arma::mat hess(d, d);
+    arma::vec step;
+    for (int i = 0; i < max_iter; i++){
+        posterior.update_grad_U(mode, grad);
+        posterior.update_hess_U(mode, hess);
+        if (!arma::solve(step, hess, grad)){
+            std::cerr << "Hessian is singular\n";
+            return 0;
+        }
+        mode -= step;
+        if (arma::norm(step) < 1e-10 * (1.0 + arma::norm(mode))){
+            posterior.update_hess_U(mode, hess);
+            cov = arma::inv_sympd(hess);
+            return 1;
+        }
+    }
+    std::cerr << "Newton's method did not converge\n";
+    return 0;
+}
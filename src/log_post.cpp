@@ -4,6 +4,7 @@
 #include "log_post.h"
 #include <armadillo>
 #include <fstream>
+#include <memory>
 
 LogPost::LogPost(int dimension)
 {
@@ -11,10 +12,13 @@ LogPost::LogPost(int dimension)
         std::cerr << "Dimension must be greater than or equal to 1\n";
     }
     m_dimension = dimension;
+    m_data = std::make_shared<const arma::mat>();
     m_data_constructed = 0;
     m_log_dens_constructed = 0;
     m_grad_log_dens_constructed = 0;
     m_laplacian_log_dens_constructed = 0;
+    m_hess_log_dens = nullptr;
+    m_hess_log_dens_constructed = 0;
 }
 
 LogPost::LogPost(int dimension,
@@ -32,7 +36,7 @@ LogPost::LogPost(int dimension,
                   << std::endl;
     }
     m_dimension = dimension;
-    m_data = data;
+    m_data = std::make_shared<const arma::mat>(data);
     m_log_dens = log_dens;
     m_grad_log_dens = grad_log_dens;
     m_laplacian_log_dens = laplacian_log_dens;
@@ -40,9 +44,17 @@ LogPost::LogPost(int dimension,
     m_log_dens_constructed = 1;
     m_grad_log_dens_constructed = 1;
     m_laplacian_log_dens_constructed= 1;
+    m_hess_log_dens = nullptr;
+    m_hess_log_dens_constructed = 0;
 }
 
 void LogPost::set_data(const arma::mat& data)
+{
+    m_data = std::make_shared<const arma::mat>(data);
+    m_data_constructed = 1;
+}
+
+void LogPost::set_data(std::shared_ptr<const arma::mat> data)
 {
     m_data = data;
     m_data_constructed = 1;
@@ -71,6 +83,14 @@ void LogPost::set_laplacian_log_dens(double (*laplacian_log_dens)
     m_laplacian_log_dens_constructed = 1;
 }
 
+void LogPost::set_hess_log_dens(void (*hess_log_dens)(const arma::vec& state,
+                                                      arma::mat& hess,
+                                                      const arma::mat& data))
+{
+    m_hess_log_dens = hess_log_dens;
+    m_hess_log_dens_constructed = 1;
+}
+
 int LogPost::get_dimension()
 {
     return m_dimension;
@@ -79,7 +99,7 @@ int LogPost::get_dimension()
 void LogPost::print_data()
 {
     if (m_data_constructed){
-        m_data.print();
+        m_data->print();
     } else {
         std::cerr << "Data hasn't been constructed yet\n";
     }
@@ -89,7 +109,7 @@ void LogPost::print_data(std::ofstream &file)
 {
     if (m_data_constructed)
     {
-        m_data.print(file);
+        m_data->print(file);
     } else {
         std::cerr << "Data hasn't been constructed yet\n";
     }
@@ -97,7 +117,7 @@ void LogPost::print_data(std::ofstream &file)
 
 double LogPost::log_dens(const arma::vec& state)
 {
-    return m_log_dens(state, m_data);
+    return m_log_dens(state, *m_data);
 }
 
 double LogPost::U(const arma::vec& state)
@@ -108,7 +128,7 @@ double LogPost::U(const arma::vec& state)
 void LogPost::update_grad_log_dens(const arma::vec& state,
                                    arma::vec& grad)
 {
-    m_grad_log_dens(state, grad, m_data);
+    m_grad_log_dens(state, grad, *m_data);
 }
 
 void LogPost::update_grad_U(const arma::vec& state,
@@ -120,7 +140,7 @@ void LogPost::update_grad_U(const arma::vec& state,
 
 double LogPost::laplacian_log_dens(const arma::vec& state)
 {
-    return m_laplacian_log_dens(state, m_data);
+    return m_laplacian_log_dens(state, *m_data);
 }
 
 double LogPost::laplacian_U(const arma::vec& state)
@@ -128,6 +148,19 @@ double LogPost::laplacian_U(const arma::vec& state)
     return -laplacian_log_dens(state);
 }
 
+void LogPost::update_hess_log_dens(const arma::vec& state,
+                                   arma::mat& hess)
+{
+    m_hess_log_dens(state, hess, *m_data);
+}
+
+void LogPost::update_hess_U(const arma::vec& state,
+                            arma::mat& hess)
+{
+    update_hess_log_dens(state, hess);
+    hess *= -1;
+}
+
 int LogPost::is_log_dens_constructed()
 {
     return m_log_dens_constructed;
@@ -142,3 +175,8 @@ int LogPost::is_laplacian_log_dens_constructed()
 {
     return m_laplacian_log_dens_constructed;
 }
+
+int LogPost::is_hess_log_dens_constructed()
+{
+    return m_hess_log_dens_constructed;
+}
@@ -0,0 +1,91 @@
+/* Functions for Bayesian logistic regression
+ */
+#include "logistic.h"
+#include <armadillo>
+#include <cmath>
+
+double ld_logistic(const arma::vec &state,
+                   const arma::mat &data)
+{
+    int n = data.n_rows;
+    int d = state.n_elem;
+    double ld = -0.5 * arma::dot(state, state);
+    double eta;
+    for (int i = 0; i < n; i++){
+        eta = 0;
+        for (int j = 0; j < d; j++){
+            eta += data(i, j+1) * state(j);
+        }
+        // log(1 + exp(eta)), computed stably
+        if (eta > 0){
+            ld += data(i, 0) * eta - eta - log1p(exp(-eta));
+        } else {
+            ld += data(i, 0) * eta - log1p(exp(eta));
+        }
+    }
+    return ld;
+}
+
+void grad_ld_logistic(const arma::vec &state,
+                      arma::vec &grad,
+                      const arma::mat &data)
+{
+    int n = data.n_rows;
+    int d = state.n_elem;
+    double eta, p;
+    grad = -state;
+    for (int i = 0; i < n; i++){
+        eta = 0;
+        for (int j = 0; j < d; j++){
+            eta += data(i, j+1) * state(j);
+        }
+        p = 1.0 / (1.0 + exp(-eta));
+        for (int j = 0; j < d; j++){
+            grad(j) += (data(i, 0) - p) * data(i, j+1);
+        }
+    }
+}
+
+double lap_ld_logistic(const arma::vec &state,
+                       const arma::mat &data)
+{
+    int n = data.n_rows;
+    int d = state.n_elem;
+    double lap = -d;
+    double eta, p, sq;
+    for (int i = 0; i < n; i++){
+        eta = 0;
+        sq = 0;
+        for (int j = 0; j < d; j++){
+            eta += data(i, j+1) * state(j);
+            sq += data(i, j+1) * data(i, j+1);
+        }
+        p = 1.0 / (1.0 + exp(-eta));
+        lap -= p * (1.0 - p) * sq;
+    }
+    return lap;
+}
+
+void hess_ld_logistic(const arma::vec &state,
+                      arma::mat &hess,
+                      const arma::mat &data)
+{
+    int n = data.n_rows;
+    int d = state.n_elem;
+    double eta, w;
+    hess.eye(d, d);
+    hess *= -1;
+    for (int i = 0; i < n; i++){
+        eta = 0;
+        for (int j = 0; j < d; j++){
+            eta += data(i, j+1) * state(j);
+        }
+        w = 1.0 / (1.0 + exp(-eta));
+        w *= 1.0 - w;
+        for (int j = 0; j < d; j++){
+            for (int k = 0; k < d; k++){
+                hess(j, k) -= w * data(i, j+1) * data(i, k+1);
+            }
+        }
+    }
+}
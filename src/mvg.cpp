@@ -1,9 +1,11 @@
 /* Functions for multivariate Gaussian distributions
  */
 #include "mvg.h"
+#include <algorithm>
 #include <armadillo>
 #include <cmath>
 #include <random>
+#include <vector>
 
 double ld_mvg_iso(const arma::vec &state,
                   const arma::mat &data)
@@ -24,3 +26,192 @@ int rmvg_iso(std::mt19937_64 &generator,
     }
     return 0;
 }
+
+int rmvg_iso_batch(std::mt19937_64 &generator,
+                   arma::mat &states,
+                   const arma::mat &data)
+{
+    std::normal_distribution<double> rnorm(0.0, 1.0);
+    for (arma::mat::iterator it = states.begin(); it != states.end(); ++it)
+    {
+        *it = rnorm(generator);
+    }
+    return 0;
+}
+
+int qmvg_iso(const arma::vec &u,
+             arma::vec &state,
+             const arma::mat &data)
+{
+    int d = state.n_elem;
+    for (int j = 0; j < d; j++){
+        state(j) = qnorm(u(j));
+    }
+    return 0;
+}
+
+double ld_mvg_iso_mix(const arma::vec &state,
+                      const arma::mat &data)
+{
+    int d = state.n_elem;
+    int K = data.n_cols;
+    arma::vec log_terms(K);
+    for (int k = 0; k < K; k++){
+        double sd = data(d+1, k);
+        double sq = 0;
+        for (int j = 0; j < d; j++){
+            double z = (state(j) - data(j+1, k)) / sd;
+            sq += z * z;
+        }
+        log_terms(k) = log(data(0, k)) - d * log(sd)
+                       - 0.5*d*log(2.0*M_PI) - 0.5 * sq;
+    }
+    // Log-sum-exp
+    double m = log_terms.max();
+    return m + log(arma::accu(arma::exp(log_terms - m)));
+}
+
+// Index of the component whose cumulative weight first exceeds u
+static int mix_component(const std::vector<double> &cum_weights, double u)
+{
+    int k = std::upper_bound(cum_weights.begin(), cum_weights.end(), u)
+            - cum_weights.begin();
+    return std::min(k, (int) cum_weights.size() - 1);
+}
+
+int rmvg_iso_mix(std::mt19937_64 &generator,
+                 arma::vec &state,
+                 const arma::mat &data)
+{
+    std::normal_distribution<double> rnorm(0.0, 1.0);
+    std::uniform_real_distribution<double> runif(0.0, 1.0);
+    int d = state.n_elem;
+    int K = data.n_cols;
+    std::vector<double> cum_weights(K);
+    double cum = 0;
+    for (int k = 0; k < K; k++){
+        cum += data(0, k);
+        cum_weights[k] = cum;
+    }
+    
+    int k = mix_component(cum_weights, runif(generator));
+    for (int j = 0; j < d; j++){
+        state(j) = data(j+1, k) + data(d+1, k) * rnorm(generator);
+    }
+    return 0;
+}
+
+int rmvg_iso_mix_batch(std::mt19937_64 &generator,
+                       arma::mat &states,
+                       const arma::mat &data)
+{
+    std::uniform_real_distribution<double> runif(0.0, 1.0);
+    int d = states.n_rows;
+    int B = states.n_cols;
+    int K = data.n_cols;
+    std::vector<double> cum_weights(K);
+    double cum = 0;
+    for (int k = 0; k < K; k++){
+        cum += data(0, k);
+        cum_weights[k] = cum;
+    }
+    
+    // Standard Gaussians for the whole batch, then shift and scale each
+    // column by its component
+    rmvg_iso_batch(generator, states, data);
+    for (int i = 0; i < B; i++){
+        int k = mix_component(cum_weights, runif(generator));
+        double *x = states.colptr(i);
+        const double *mean = data.colptr(k) + 1;
+        double sd = data(d+1, k);
+        for (int j = 0; j < d; j++){
+            x[j] = mean[j] + sd * x[j];
+        }
+    }
+    return 0;
+}
+
+int qmvg_iso_mix(const arma::vec &u,
+                 arma::vec &state,
+                 const arma::mat &data)
+{
+    int d = state.n_elem;
+    int K = data.n_cols;
+    std::vector<double> cum_weights(K);
+    double cum = 0;
+    for (int k = 0; k < K; k++){
+        cum += data(0, k);
+        cum_weights[k] = cum;
+    }
+    
+    int k = mix_component(cum_weights, u(0));
+    for (int j = 0; j < d; j++){
+        state(j) = data(j+1, k) + data(d+1, k) * qnorm(u(j+1));
+    }
+    return 0;
+}
+
+double qnorm(double p)
+{
+    // Acklam's rational approximation, followed by one step of Halley's
+    // method to reach full double precision
+    static const double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                                -2.759285104469687e+02, 1.383577518672690e+02,
+                                -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                                -1.556989798598866e+02, 6.680131188771972e+01,
+                                -1.328068155288572e+01};
+    static const double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                                -2.400758277161838e+00, -2.549732539343734e+00,
+                                4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[4] = {7.784695709041462e-03, 3.224671290700398e-01,
+                                2.445134137142996e+00, 3.754408661907416e+00};
+    const double p_low = 0.02425;
+    double q, r, x;
+    
+    if (p < p_low){
+        q = sqrt(-2.0 * log(p));
+        x = (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+            ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1.0);
+    } else if (p <= 1.0 - p_low){
+        q = p - 0.5;
+        r = q * q;
+        x = (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r + a[5]) * q /
+            (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1.0);
+    } else {
+        q = sqrt(-2.0 * log1p(-p));
+        x = -(((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+            ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1.0);
+    }
+    
+    double e = 0.5 * erfc(-x / M_SQRT2) - p;
+    double h = e * sqrt(2.0 * M_PI) * exp(0.5 * x * x);
+    return x - h / (1.0 + 0.5 * x * h);
+}
+
+double ld_mvg_prec(const arma::vec &state,
+                   const arma::mat &precision)
+{
+    arma::mat aux = state.t() * precision * state;
+    return -0.5 * aux(0,0);
+}
+
+void grad_ld_mvg_prec(const arma::vec &state,
+                      arma::vec &grad,
+                      const arma::mat &precision)
+{
+    grad = -(precision * state);
+}
+
+double lap_ld_mvg_prec(const arma::vec &state,
+                       const arma::mat &precision)
+{
+    return -arma::trace(precision);
+}
+
+void hess_ld_mvg_prec(const arma::vec &state,
+                      arma::mat &hess,
+                      const arma::mat &precision)
+{
+    hess = -precision;
+}
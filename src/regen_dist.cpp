@@ -2,11 +2,17 @@
  */
 #include "regen_dist.h"
 #include <armadillo>
+#include <iostream>
 #include <random>
 
 RegenDist::RegenDist(int dimension)
 {
     m_dimension = dimension;
+    m_rmu_batch = nullptr;
+    m_batch_size = 0;
+    m_pool_next = 0;
+    m_rmu_inverse = nullptr;
+    m_u_dimension = 0;
 }
 
 RegenDist::RegenDist(int dimension,
@@ -21,11 +27,17 @@ RegenDist::RegenDist(int dimension,
     m_log_dens = log_dens;
     m_rmu = rmu;
     m_dimension = dimension;
+    m_rmu_batch = nullptr;
+    m_batch_size = 0;
+    m_pool_next = 0;
+    m_rmu_inverse = nullptr;
+    m_u_dimension = 0;
 }
 
 void RegenDist::set_data(const arma::mat &data)
 {
     m_data = data;
+    clear_pool();
 }
 
 double RegenDist::log_dens(const arma::vec &state)
@@ -41,7 +53,59 @@ double RegenDist::U(const arma::vec &state)
 int RegenDist::rmu(std::mt19937_64 &generator,
                     arma::vec &state)
 {
-    return m_rmu(generator, state, m_data);
+    if (m_rmu_batch == nullptr){
+        return m_rmu(generator, state, m_data);
+    }
+    
+    int cost = 0;
+    if (m_pool_next >= (int) m_pool.n_cols){
+        m_pool.set_size(m_dimension, m_batch_size);
+        cost = m_rmu_batch(generator, m_pool, m_data);
+        m_pool_next = 0;
+    }
+    state = m_pool.col(m_pool_next);
+    m_pool_next++;
+    return cost;
+}
+
+void RegenDist::set_rmu_batch(int (*rmu_batch)(std::mt19937_64 &generator,
+                                               arma::mat &states,
+                                               const arma::mat &data),
+                              int batch_size)
+{
+    if (batch_size < 1){
+        std::cerr << "Batch size must be greater than or equal to 1\n";
+        return;
+    }
+    m_rmu_batch = rmu_batch;
+    m_batch_size = batch_size;
+    clear_pool();
+}
+
+void RegenDist::set_rmu_inverse(int (*rmu_inverse)(const arma::vec &u,
+                                                    arma::vec &state,
+                                                    const arma::mat &data),
+                                int u_dimension)
+{
+    m_rmu_inverse = rmu_inverse;
+    m_u_dimension = u_dimension;
+}
+
+int RegenDist::rmu_inverse(const arma::vec &u,
+                           arma::vec &state)
+{
+    return m_rmu_inverse(u, state, m_data);
+}
+
+int RegenDist::get_u_dimension()
+{
+    return m_u_dimension;
+}
+
+void RegenDist::clear_pool()
+{
+    m_pool.reset();
+    m_pool_next = 0;
 }
 
 int RegenDist::get_dimension()
@@ -0,0 +1,341 @@
+/* Long-lived local sampling service
+ */
+#include "sampling_service.h"
+#include "bmrstr.h"
+#include "log_post.h"
+#include "regen_dist.h"
+#include "thread_pool.h"
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+SamplingService::SamplingService(std::string socket_path, int nthreads)
+    : m_pool(nthreads)
+{
+    m_socket_path = socket_path;
+    m_listen_fd = -1;
+    m_stop = false;
+    if (pipe(m_wake_fd) < 0){
+        std::cerr << "Couldn't create wake-up pipe\n";
+        m_wake_fd[0] = -1;
+        m_wake_fd[1] = -1;
+    }
+}
+
+SamplingService::~SamplingService()
+{
+    stop();
+    if (m_wake_fd[0] >= 0){
+        close(m_wake_fd[0]);
+        close(m_wake_fd[1]);
+    }
+}
+
+SamplingService::Client::Client(SamplingService &service, int fd)
+    : service(service), fd(fd), nread(0)
+{
+    std::lock_guard<std::mutex> lock(service.m_client_mutex);
+    service.m_client_fds.insert(fd);
+}
+
+SamplingService::Client::~Client()
+{
+    {
+        std::lock_guard<std::mutex> lock(service.m_client_mutex);
+        service.m_client_fds.erase(fd);
+    }
+    close(fd);
+}
+
+void SamplingService::register_target(std::string name,
+                                      LogPost posterior,
+                                      RegenDist regen_dist)
+{
+    Target target = {posterior, regen_dist};
+    m_targets.erase(name);
+    m_targets.insert(std::make_pair(name, target));
+}
+
+int SamplingService::run()
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (m_socket_path.size() >= sizeof(addr.sun_path)){
+        std::cerr << "Socket path is too long\n";
+        return 0;
+    }
+    std::strcpy(addr.sun_path, m_socket_path.c_str());
+    
+    m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(m_socket_path.c_str());
+    if (m_listen_fd < 0 || m_wake_fd[0] < 0 ||
+        bind(m_listen_fd, (sockaddr*) &addr, sizeof(addr)) < 0 ||
+        listen(m_listen_fd, 64) < 0){
+        std::cerr << "Couldn't listen on " << m_socket_path << '\n';
+        if (m_listen_fd >= 0){
+            close(m_listen_fd);
+            m_listen_fd = -1;
+        }
+        return 0;
+    }
+    // A connection may vanish between poll and accept
+    fcntl(m_listen_fd, F_SETFL, fcntl(m_listen_fd, F_GETFL) | O_NONBLOCK);
+    
+    // Connections being polled for requests
+    std::map<int, std::shared_ptr<Client>> clients;
+    std::vector<pollfd> fds;
+    std::chrono::steady_clock::time_point accept_resume;
+    
+    while (!m_stop){
+        bool accepting = std::chrono::steady_clock::now() >= accept_resume;
+        fds.clear();
+        fds.push_back({m_wake_fd[0], POLLIN, 0});
+        fds.push_back({accepting ? m_listen_fd : -1, POLLIN, 0});
+        for (auto &c : clients){
+            fds.push_back({c.first, POLLIN, 0});
+        }
+        
+        if (poll(fds.data(), fds.size(),
+                 accepting ? -1 : SERVICE_ACCEPT_RETRY_MS) < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            std::cerr << "poll failed: " << std::strerror(errno) << '\n';
+            break;
+        }
+        
+        if (fds[1].revents & POLLIN){
+            int fd = accept(m_listen_fd, nullptr, nullptr);
+            if (fd >= 0){
+                clients[fd] = std::make_shared<Client>(*this, fd);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK &&
+                       errno != EINTR && errno != ECONNABORTED){
+                // Persistent errors such as running out of file
+                // descriptors: back off rather than spin
+                std::cerr << "accept failed: " << std::strerror(errno)
+                          << '\n';
+                accept_resume = std::chrono::steady_clock::now()
+                    + std::chrono::milliseconds(SERVICE_ACCEPT_RETRY_MS);
+            }
+        }
+        
+        for (std::size_t i = 2; i < fds.size(); i++){
+            if (fds[i].revents && !read_request(clients[fds[i].fd])){
+                // Jobs in flight keep the connection open to reply
+                clients.erase(fds[i].fd);
+            }
+        }
+    }
+    
+    close(m_listen_fd);
+    unlink(m_socket_path.c_str());
+    m_listen_fd = -1;
+    stop();
+    return 1;
+}
+
+void SamplingService::stop()
+{
+    m_stop = true;
+    if (m_wake_fd[1] >= 0){
+        char c = 0;
+        ssize_t w = write(m_wake_fd[1], &c, 1);
+        (void) w;
+    }
+    
+    // Fail any blocked writes, so jobs in flight return promptly
+    std::lock_guard<std::mutex> lock(m_client_mutex);
+    for (int fd : m_client_fds){
+        shutdown(fd, SHUT_RDWR);
+    }
+}
+
+int SamplingService::read_request(std::shared_ptr<Client> client)
+{
+    char *p = (char*) &client->request;
+    ssize_t r = read(client->fd, p + client->nread,
+                     sizeof(JobRequest) - client->nread);
+    if (r <= 0){
+        return r < 0 && errno == EINTR;
+    }
+    client->nread += r;
+    if (client->nread == sizeof(JobRequest)){
+        JobRequest request = client->request;
+        client->nread = 0;
+        m_pool.submit([this, client, request]{ run_job(client, request); });
+    }
+    return 1;
+}
+
+void SamplingService::run_job(std::shared_ptr<Client> client,
+                              const JobRequest &request)
+{
+    if (m_stop){
+        return;
+    }
+    
+    JobHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.id = request.id;
+    
+    std::string name(request.target,
+                     strnlen(request.target, SERVICE_TARGET_NAME_LENGTH));
+    std::map<std::string, Target>::iterator it = m_targets.find(name);
+    if (it == m_targets.end()){
+        header.status = SERVICE_UNKNOWN_TARGET;
+    } else if (request.ntours < 1 || request.ntours > SERVICE_MAX_NTOURS ||
+               !std::isfinite(request.logC) ||
+               !(request.kappa_bar > 0) ||
+               !(request.kappa_bar <= SERVICE_MAX_RATE) ||
+               !(request.output_rate > 0) ||
+               !(request.output_rate <= SERVICE_MAX_RATE)){
+        header.status = SERVICE_BAD_REQUEST;
+    }
+    if (header.status != SERVICE_OK){
+        std::lock_guard<std::mutex> lock(client->write_mutex);
+        write_full(client->fd, &header, sizeof(header));
+        return;
+    }
+    
+    // Copying the LogPost shares its data. An exception escaping a job,
+    // e.g. running out of memory, would terminate the service.
+    std::unique_ptr<BMRestore> X;
+    try {
+        X.reset(new BMRestore(it->second.posterior, it->second.regen_dist,
+                              request.logC, request.kappa_bar, request.ntours,
+                              request.output_rate));
+        X->set_seed(request.seed);
+        X->gen_fixed_ntours();
+    } catch (const std::exception &e){
+        std::cerr << "Job failed: " << e.what() << '\n';
+        X.reset();
+        header.status = SERVICE_FAILED;
+        std::lock_guard<std::mutex> lock(client->write_mutex);
+        write_full(client->fd, &header, sizeof(header));
+        return;
+    }
+    
+    header.dimension = X->get_dimension();
+    header.noutputs = X->get_noutputs();
+    header.nevals = X->get_nevals();
+    
+    std::size_t n = header.noutputs;
+    std::lock_guard<std::mutex> lock(client->write_mutex);
+    int ok = write_full(client->fd, &header, sizeof(header));
+    if (ok && (request.output & SERVICE_OUTPUT_STATES)){
+        ok = write_full(client->fd, X->get_output_states_data(),
+                        n * header.dimension * sizeof(double));
+    }
+    if (ok && (request.output & SERVICE_OUTPUT_TIMES)){
+        ok = write_full(client->fd, X->get_output_times_data(),
+                        n * sizeof(double));
+    }
+    if (ok && (request.output & SERVICE_OUTPUT_TOURS)){
+        ok = write_full(client->fd, X->get_output_tour_number_data(),
+                        n * sizeof(int));
+    }
+    if (!ok){
+        // A partial reply leaves the stream unusable
+        shutdown(client->fd, SHUT_RDWR);
+    }
+}
+
+int read_full(int fd, void *buf, std::size_t n)
+{
+    char *p = (char*) buf;
+    while (n > 0){
+        ssize_t r = read(fd, p, n);
+        if (r <= 0){
+            return 0;
+        }
+        p += r;
+        n -= r;
+    }
+    return 1;
+}
+
+int write_full(int fd, const void *buf, std::size_t n)
+{
+    const char *p = (const char*) buf;
+    while (n > 0){
+        std::size_t block = n < SERVICE_BLOCK_SIZE ? n : SERVICE_BLOCK_SIZE;
+        ssize_t w = send(fd, p, block, MSG_NOSIGNAL);
+        if (w <= 0){
+            return 0;
+        }
+        p += w;
+        n -= w;
+    }
+    return 1;
+}
+
+int service_connect(std::string socket_path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)){
+        return -1;
+    }
+    std::strcpy(addr.sun_path, socket_path.c_str());
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr*) &addr, sizeof(addr)) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int service_submit(int fd,
+                   const JobRequest &request,
+                   JobHeader &header,
+                   std::vector<double> &states,
+                   std::vector<double> &times,
+                   std::vector<int> &tours)
+{
+    if (!write_full(fd, &request, sizeof(request)) ||
+        !read_full(fd, &header, sizeof(header))){
+        return 0;
+    }
+    if (header.status != SERVICE_OK){
+        return 1;
+    }
+    
+    std::size_t n = header.noutputs;
+    if (request.output & SERVICE_OUTPUT_STATES){
+        states.resize(n * header.dimension);
+        if (!read_full(fd, states.data(), states.size() * sizeof(double))){
+            return 0;
+        }
+    }
+    if (request.output & SERVICE_OUTPUT_TIMES){
+        times.resize(n);
+        if (!read_full(fd, times.data(), n * sizeof(double))){
+            return 0;
+        }
+    }
+    if (request.output & SERVICE_OUTPUT_TOURS){
+        tours.resize(n);
+        if (!read_full(fd, tours.data(), n * sizeof(int))){
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,134 @@
+/* Scrambled Sobol sequence
+ */
+#include "sobol.h"
+#include <armadillo>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Degree s, coefficients a and initial direction numbers m of the
+// primitive polynomial of each dimension after the first
+static const int sobol_s[SOBOL_MAX_DIMENSION - 1] =
+    {1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6, 7, 7};
+static const int sobol_a[SOBOL_MAX_DIMENSION - 1] =
+    {0, 1, 1, 2, 1, 4, 2, 4, 7, 11, 13, 14, 1, 13, 16, 19, 22, 25, 1, 4};
+static const int sobol_m[SOBOL_MAX_DIMENSION - 1][7] = {
+    {1},
+    {1, 3},
+    {1, 3, 1},
+    {1, 1, 1},
+    {1, 1, 3, 3},
+    {1, 3, 5, 13},
+    {1, 1, 5, 5, 17},
+    {1, 1, 5, 5, 5},
+    {1, 1, 7, 11, 19},
+    {1, 1, 5, 1, 1},
+    {1, 1, 1, 3, 11},
+    {1, 3, 5, 5, 31},
+    {1, 3, 3, 9, 7, 49},
+    {1, 1, 1, 15, 21, 21},
+    {1, 3, 1, 13, 27, 49},
+    {1, 1, 1, 15, 7, 5},
+    {1, 3, 1, 15, 13, 25},
+    {1, 1, 5, 5, 19, 61},
+    {1, 3, 7, 11, 23, 15, 103},
+    {1, 3, 7, 13, 13, 15, 69}};
+
+// Parity of the number of set bits
+static uint32_t parity(uint32_t x)
+{
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+SobolSequence::SobolSequence(int dimension, unsigned int scramble_seed)
+{
+    if (dimension > SOBOL_MAX_DIMENSION){
+        std::cerr << "Sobol sequence has at most " << SOBOL_MAX_DIMENSION
+                  << " dimensions\n";
+        dimension = SOBOL_MAX_DIMENSION;
+    }
+    m_dimension = dimension;
+    m_index = 0;
+    m_direction.assign(dimension, std::vector<uint32_t>(SOBOL_BITS));
+    m_x.assign(dimension, 0);
+    
+    std::mt19937 gen(scramble_seed);
+    for (int j = 0; j < dimension; j++){
+        std::vector<uint32_t> &v = m_direction[j];
+        
+        // Unscrambled direction numbers, most significant bit first
+        if (j == 0){
+            for (int k = 0; k < SOBOL_BITS; k++){
+                v[k] = (uint32_t) 1 << (SOBOL_BITS - 1 - k);
+            }
+        } else {
+            int s = sobol_s[j-1];
+            int a = sobol_a[j-1];
+            for (int k = 0; k < s && k < SOBOL_BITS; k++){
+                v[k] = (uint32_t) sobol_m[j-1][k] << (SOBOL_BITS - 1 - k);
+            }
+            for (int k = s; k < SOBOL_BITS; k++){
+                v[k] = v[k-s] ^ (v[k-s] >> s);
+                for (int i = 1; i < s; i++){
+                    if ((a >> (s - 1 - i)) & 1){
+                        v[k] ^= v[k-i];
+                    }
+                }
+            }
+        }
+        
+        // Random lower triangular matrix with unit diagonal. Row i gives
+        // digit i (bit SOBOL_BITS - 1 - i) of the scrambled number as the
+        // parity of the leading i + 1 digits selected by the row.
+        std::vector<uint32_t> rows(SOBOL_BITS);
+        for (int i = 0; i < SOBOL_BITS; i++){
+            uint32_t leading = i == SOBOL_BITS - 1 ?
+                               0xffffffffu : ~(0xffffffffu >> (i + 1));
+            uint32_t diag = (uint32_t) 1 << (SOBOL_BITS - 1 - i);
+            rows[i] = ((uint32_t) gen() & leading) | diag;
+        }
+        for (int k = 0; k < SOBOL_BITS; k++){
+            uint32_t scrambled = 0;
+            for (int i = 0; i < SOBOL_BITS; i++){
+                scrambled |= parity(rows[i] & v[k]) << (SOBOL_BITS - 1 - i);
+            }
+            v[k] = scrambled;
+        }
+        
+        // Random digital shift
+        m_x[j] = (uint32_t) gen();
+    }
+}
+
+void SobolSequence::next(arma::vec &u)
+{
+    for (int j = 0; j < m_dimension; j++){
+        // Centre of the cell, so that no coordinate is 0 or 1
+        u(j) = (m_x[j] + 0.5) / 4294967296.0;
+    }
+    
+    // Gray code: flip the direction number of the lowest zero bit of index
+    int c = 0;
+    uint64_t i = m_index;
+    while (i & 1){
+        i >>= 1;
+        c++;
+    }
+    if (c < SOBOL_BITS){
+        for (int j = 0; j < m_dimension; j++){
+            m_x[j] ^= m_direction[j][c];
+        }
+    }
+    m_index++;
+}
+
+int SobolSequence::get_dimension()
+{
+    return m_dimension;
+}
@@ -0,0 +1,238 @@
+/* Parameter sweep over configurations of BMRestore for a single target
+ */
+#include "sweep.h"
+#include "bmrstr.h"
+#include "diffusion.h"
+#include "log_post.h"
+#include "regen_dist.h"
+#include "thread_pool.h"
+#include <armadillo>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+Sweep::Sweep(LogPost posterior, int nthreads, unsigned int seed)
+{
+    m_posterior = posterior;
+    m_nthreads = nthreads;
+    m_seed = seed;
+    m_pilot_secs = 0;
+}
+
+void Sweep::add_config(double logC,
+                       double kappa_bar,
+                       RegenDist regen_dist,
+                       std::string regen_name,
+                       double output_rate,
+                       int precondition)
+{
+    Config config;
+    config.precondition = precondition;
+    config.logC = logC;
+    config.kappa_bar = kappa_bar;
+    config.output_rate = output_rate;
+    config.regen_name = regen_name;
+    config.sampler.reset(new BMRestore(m_posterior, regen_dist, logC,
+                                       kappa_bar, 0, output_rate));
+    config.sampler->set_seed(m_seed + m_configs.size());
+    config.secs = 0;
+    config.min_ess = 0;
+    config.ess_per_sec = 0;
+    config.stopped = -1;
+    m_configs.push_back(std::move(config));
+}
+
+void Sweep::add_grid(const std::vector<double> &logC,
+                     const std::vector<double> &kappa_bar,
+                     const std::vector<RegenDist> &regen_dist,
+                     const std::vector<std::string> &regen_name,
+                     const std::vector<double> &output_rate,
+                     const std::vector<int> &precondition)
+{
+    if (regen_name.size() != regen_dist.size()){
+        std::cerr << "Need one name per regeneration distribution\n";
+        return;
+    }
+    for (unsigned int i = 0; i < logC.size(); i++){
+        for (unsigned int j = 0; j < kappa_bar.size(); j++){
+            for (unsigned int k = 0; k < regen_dist.size(); k++){
+                for (unsigned int l = 0; l < output_rate.size(); l++){
+                    for (unsigned int m = 0; m < precondition.size(); m++){
+                        add_config(logC[i], kappa_bar[j], regen_dist[k],
+                                   regen_name[k], output_rate[l],
+                                   precondition[m]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Sweep::set_pilot(int pilot_ntours,
+                      double logC,
+                      double kappa_bar,
+                      RegenDist regen_dist)
+{
+    m_pilot.reset(new BMRestore(m_posterior, regen_dist, logC, kappa_bar,
+                                pilot_ntours));
+    m_pilot->set_seed(m_seed - 1);
+    m_pilot_secs = 0;
+}
+
+int Sweep::run_pilot()
+{
+    if (!m_pilot){
+        std::cerr << "Preconditioned configurations need a pilot run\n";
+        return 0;
+    }
+    
+    timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    m_pilot->gen_fixed_ntours();
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    m_pilot_secs = (end.tv_sec - start.tv_sec)
+                   + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    
+    int n = m_pilot->get_noutputs();
+    int d = m_pilot->get_dimension();
+    if (n < 2){
+        std::cerr << "Too few output states in the pilot run\n";
+        return 0;
+    }
+    arma::mat x(m_pilot->get_output_states_data(), d, n);
+    
+    // One process shared by every preconditioned configuration
+    std::shared_ptr<Diffusion> diffusion = std::make_shared<BrownianMotion>(d);
+    if (!diffusion->set_covariance(arma::cov(x.t()))){
+        return 0;
+    }
+    for (std::vector<Config>::iterator it = m_configs.begin();
+         it != m_configs.end(); ++it){
+        if (it->precondition){
+            it->sampler->set_diffusion(diffusion);
+        }
+    }
+    return 1;
+}
+
+void Sweep::run_stage(Config &config, int ntours)
+{
+    BMRestore &X = *config.sampler;
+    
+    // Time on this thread's CPU clock, so that configurations sharing the
+    // pool aren't charged for each other
+    timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    X.set_ntours(X.get_ntours_completed() + ntours);
+    X.gen_fixed_ntours();
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    config.secs += (end.tv_sec - start.tv_sec)
+                   + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    
+    arma::vec ess;
+    X.ess(ess);
+    config.min_ess = ess.min();
+    config.ess_per_sec = config.min_ess / config.secs;
+}
+
+void Sweep::run(int ntours_per_stage, int nstages, double keep_fraction)
+{
+    for (std::vector<Config>::iterator it = m_configs.begin();
+         it != m_configs.end(); ++it){
+        if (it->precondition){
+            if (!run_pilot()){
+                std::cerr << "Pilot run failed, dropping preconditioned "
+                          << "configurations\n";
+                for (std::vector<Config>::iterator jt = m_configs.begin();
+                     jt != m_configs.end(); ++jt){
+                    if (jt->precondition){
+                        jt->stopped = -2;
+                    }
+                }
+            }
+            break;
+        }
+    }
+    
+    ThreadPool pool(m_nthreads);
+    for (int stage = 0; stage < nstages; stage++){
+        for (std::vector<Config>::iterator it = m_configs.begin();
+             it != m_configs.end(); ++it){
+            if (it->stopped == -1){
+                Config *config = &(*it);
+                pool.submit([this, config, ntours_per_stage]{
+                    run_stage(*config, ntours_per_stage);
+                });
+            }
+        }
+        pool.wait();
+        
+        if (stage == nstages - 1){
+            break;
+        }
+        
+        // Stop configurations well behind the best valid one
+        double best = 0;
+        for (std::vector<Config>::iterator it = m_configs.begin();
+             it != m_configs.end(); ++it){
+            if (it->stopped == -1 && it->sampler->get_nviolations() == 0 &&
+                it->ess_per_sec > best){
+                best = it->ess_per_sec;
+            }
+        }
+        for (std::vector<Config>::iterator it = m_configs.begin();
+             it != m_configs.end(); ++it){
+            if (it->stopped == -1 &&
+                (!(it->ess_per_sec >= keep_fraction * best)
+                 || it->sampler->get_nviolations() > 0)){
+                it->stopped = stage;
+            }
+        }
+    }
+}
+
+void Sweep::print_table()
+{
+    if (m_pilot && m_pilot->get_ntours_completed() > 0){
+        std::cout << "Pilot run: " << m_pilot->get_ntours_completed()
+                  << " tours, " << m_pilot_secs << " CPU seconds, "
+                  << "shared by preconditioned configurations\n";
+    }
+    std::cout << std::setw(8) << "logC"
+              << std::setw(10) << "kappa_bar"
+              << std::setw(14) << "regen"
+              << std::setw(12) << "output_rate"
+              << std::setw(9) << "precond"
+              << std::setw(8) << "tours"
+              << std::setw(12) << "evals/tour"
+              << std::setw(10) << "min ESS"
+              << std::setw(10) << "ESS/sec"
+              << std::setw(12) << "violations"
+              << std::setw(10) << "stopped" << '\n';
+    for (std::vector<Config>::iterator it = m_configs.begin();
+         it != m_configs.end(); ++it){
+        BMRestore &X = *it->sampler;
+        int ntours = X.get_ntours_completed();
+        std::cout << std::setw(8) << it->logC
+                  << std::setw(10) << it->kappa_bar
+                  << std::setw(14) << it->regen_name
+                  << std::setw(12) << it->output_rate
+                  << std::setw(9) << it->precondition
+                  << std::setw(8) << ntours
+                  << std::setw(12)
+                  << (ntours > 0 ? (double) X.get_nevals() / ntours : 0.0)
+                  << std::setw(10) << it->min_ess
+                  << std::setw(10) << it->ess_per_sec
+                  << std::setw(12) << X.get_nviolations();
+        if (it->stopped == -1){
+            std::cout << std::setw(10) << "-" << '\n';
+        } else if (it->stopped == -2){
+            std::cout << std::setw(10) << "no pilot" << '\n';
+        } else {
+            std::cout << std::setw(10) << it->stopped << '\n';
+        }
+    }
+}
@@ -0,0 +1,69 @@
+/* Fixed-size pool of threads running queued tasks in order of submission
+ */
+#include "thread_pool.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+ThreadPool::ThreadPool(int nthreads)
+{
+    m_stop = false;
+    m_pending = 0;
+    for (int i = 0; i < nthreads; i++){
+        m_workers.push_back(std::thread(&ThreadPool::work, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (std::vector<std::thread>::iterator it = m_workers.begin();
+         it != m_workers.end(); ++it){
+        it->join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push(task);
+        m_pending++;
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv_done.wait(lock, [this]{ return m_pending == 0; });
+}
+
+void ThreadPool::work()
+{
+    while (true){
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]{ return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty()){
+                return;
+            }
+            task = m_tasks.front();
+            m_tasks.pop();
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending--;
+        }
+        m_cv_done.notify_all();
+    }
+}
@@ -0,0 +1,185 @@
+/* Streams of pre-generated random variates
+ */
+#include "variate_stream.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+VariateRing::VariateRing(unsigned int seed, std::size_t capacity)
+{
+    std::size_t n = 1;
+    while (n < capacity){
+        n *= 2;
+    }
+    m_buf.resize(n);
+    m_mask = n - 1;
+    m_gen.seed(seed);
+    m_head = 0;
+    m_tail = 0;
+}
+
+double VariateRing::pop()
+{
+    std::size_t h = m_head.load(std::memory_order_relaxed);
+    double v = m_buf[h & m_mask];
+    m_head.store(h + 1, std::memory_order_release);
+    return v;
+}
+
+std::size_t VariateRing::size()
+{
+    return m_tail.load(std::memory_order_acquire)
+           - m_head.load(std::memory_order_relaxed);
+}
+
+std::size_t VariateRing::capacity()
+{
+    return m_buf.size();
+}
+
+std::size_t VariateRing::fill(int kind)
+{
+    std::size_t t = m_tail.load(std::memory_order_relaxed);
+    std::size_t n = m_buf.size() - (t - m_head.load(std::memory_order_acquire));
+    std::exponential_distribution<double> rexp(1.0);
+    std::uniform_real_distribution<double> runif(0.0, 1.0);
+    for (std::size_t i = 0; i < n; i++){
+        double &v = m_buf[(t + i) & m_mask];
+        switch (kind){
+        case 0:
+            v = rexp(m_gen);
+            break;
+        case 1:
+            v = runif(m_gen);
+            break;
+        default:
+            v = m_rnorm(m_gen);
+        }
+    }
+    m_tail.store(t + n, std::memory_order_release);
+    return n;
+}
+
+// Below 2, a ring can't drop below half its capacity while holding variates
+static std::size_t valid_capacity(std::size_t capacity)
+{
+    return capacity < 2 ? 2 : capacity;
+}
+
+VariateStream::VariateStream(unsigned int seed, int mode, std::size_t capacity)
+    : m_mode(mode),
+      m_exp(seed, valid_capacity(capacity)),
+      m_unif(seed + 1, valid_capacity(capacity)),
+      m_norm(seed + 2, valid_capacity(capacity)),
+      m_stop(false),
+      m_producer_waiting(false),
+      m_consumer_waiting(false)
+{
+    if (capacity < 2){
+        std::cerr << "Variate capacity must be at least 2, using 2\n";
+    }
+    if (m_mode == VARIATE_THREAD){
+        m_producer = std::thread(&VariateStream::produce, this);
+    }
+}
+
+VariateStream::~VariateStream()
+{
+    if (m_producer.joinable()){
+        m_stop = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_wake_producer.notify_one();
+        m_producer.join();
+    }
+}
+
+double VariateStream::exponential()
+{
+    return pop(m_exp, 0);
+}
+
+double VariateStream::uniform()
+{
+    return pop(m_unif, 1);
+}
+
+double VariateStream::normal()
+{
+    return pop(m_norm, 2);
+}
+
+double VariateStream::pop(VariateRing &ring, int kind)
+{
+    if (m_mode != VARIATE_THREAD){
+        if (ring.size() == 0){
+            ring.fill(kind);
+        }
+        return ring.pop();
+    }
+    
+    if (ring.size() == 0){
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_consumer_waiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_wake_producer.notify_one();
+        m_wake_consumer.wait(lock, [&ring]{ return ring.size() > 0; });
+        m_consumer_waiting = false;
+    }
+    double v = ring.pop();
+    
+    // The fence orders the pop before reading the flag, and the producer
+    // orders setting the flag before checking the rings, so either the
+    // producer sees the pop or the consumer sees that it is asleep
+    if (ring.size() < ring.capacity() / 2){
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producer_waiting.load(std::memory_order_relaxed)){
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            m_wake_producer.notify_one();
+        }
+    }
+    return v;
+}
+
+bool VariateStream::low()
+{
+    return m_exp.size() < m_exp.capacity() / 2
+           || m_unif.size() < m_unif.capacity() / 2
+           || m_norm.size() < m_norm.capacity() / 2;
+}
+
+void VariateStream::produce()
+{
+    while (!m_stop){
+        m_exp.fill(0);
+        m_unif.fill(1);
+        m_norm.fill(2);
+        
+        // Wake the consumer if it is waiting on an empty ring
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumer_waiting.load(std::memory_order_relaxed)){
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            m_wake_consumer.notify_one();
+        }
+        
+        // Sleep until a ring drops below half its capacity, or the consumer
+        // waits on an empty ring
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_producer_waiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_wake_producer.wait(lock, [this]{
+            return m_stop || m_consumer_waiting || low();
+        });
+        m_producer_waiting = false;
+    }
+}